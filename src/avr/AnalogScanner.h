@@ -0,0 +1,211 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Analog scanner
+//
+//  The ADC converts only the inputs attached with adc_attach() (PED_ANALOG and PED_LADDER
+//  rings), one after the other, in its conversion complete interrupt: each result selects
+//  the next channel and starts its conversion, so the converter never stops and the main
+//  loop never waits for it.
+//
+//  Every input is oversampled ADC_OVERSAMPLING times and decimated to 10 + ADC_OVERSAMPLING_BITS
+//  bits. Decimated values go to the back buffer of adcSamples[], swapped with the front buffer
+//  when all the inputs are done, so adc_read() always returns values of the same complete set.
+//  analogRead() must not be used while the scanner is running: adc_probe() converts any other
+//  analog pin once, between two sweeps, without stopping the scanner.
+//
+
+#include <util/atomic.h>
+
+#define ADC_CHANNELS        PEDALS                                          // one channel per ring (A0, A1, ...)
+#define ADC_PRESCALER       ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))    // 16 MHz / 128 = 125 kHz (104 us per conversion)
+#define ADC_OVERSAMPLING_BITS   2                                           // extra bits of resolution
+#define ADC_OVERSAMPLING    (1 << (2 * ADC_OVERSAMPLING_BITS))              // 4 samples per extra bit
+#define ADC_HIRES_RESOLUTION    (ADC_RESOLUTION << ADC_OVERSAMPLING_BITS)
+
+#define ADC_CHANNEL(pin)    ((pin) - PIN_A0)
+
+byte              adcChannels[ADC_CHANNELS];      // channels to convert in sequence
+byte              adcChannelsCount  = 0;
+volatile int      adcSamples[2][ADC_CHANNELS];    // last decimated value of each channel
+unsigned int      adcSum[ADC_CHANNELS];           // sum of the samples of the current set (interrupt only)
+volatile byte     adcFront          = 0;          // buffer read by the main loop
+volatile byte     adcSet            = 0;          // sets completed, wrapping
+volatile byte     adcNext           = 0;          // position in adcChannels[] being converted
+byte              adcSweeps         = 0;          // sweeps of the current set (interrupt only)
+volatile byte     adcProbe          = 0xFF;       // channel requested by adc_probe(), 0xFF if none
+volatile bool     adcProbing        = false;      // conversion in progress is the probe
+volatile int      adcProbeValue     = -1;         // result of the probe, -1 until available
+
+//
+//  Select the input of the next conversion (AVcc reference)
+//
+void adc_select(byte channel)
+{
+#ifdef MUX5
+  if (channel & 0x08) ADCSRB |= (1 << MUX5);
+  else ADCSRB &= ~(1 << MUX5);
+#endif
+  ADMUX = (1 << REFS0) | (channel & 0x07);
+}
+
+//
+//  Stop the scanner at the end of the conversion in progress and detach all the inputs
+//
+void adc_reset()
+{
+  ADCSRA &= ~(1 << ADIE);
+  while (ADCSRA & (1 << ADSC));
+  adcChannelsCount = 0;
+  adcNext          = 0;
+  adcSweeps        = 0;
+  adcProbe         = 0xFF;
+  adcProbing       = false;
+  adcProbeValue    = -1;
+}
+
+//
+//  Add an analog pin to the sweep (scanner stopped)
+//
+void adc_attach(byte pin)
+{
+  byte channel = ADC_CHANNEL(pin);
+
+  if (adcChannelsCount >= ADC_CHANNELS) return;
+  for (byte i = 0; i < adcChannelsCount; i++)
+    if (adcChannels[i] == channel) return;
+
+  adcChannels[adcChannelsCount++] = channel;
+
+  // Start from a real value in both buffers
+  adcSamples[0][channel] = adcSamples[1][channel] = analogRead(pin) << ADC_OVERSAMPLING_BITS;
+  adcSum[channel] = 0;
+}
+
+//
+//  Start the conversion of the first input, the interrupt will chain all the others
+//
+void adc_start()
+{
+  if (adcChannelsCount == 0) return;
+
+  adcNext = 0;
+  adc_select(adcChannels[0]);
+  ADCSRA = (1 << ADEN) | (1 << ADIF) | (1 << ADIE) | ADC_PRESCALER;
+  ADCSRA |= (1 << ADSC);
+}
+
+//
+//  Last decimated value [0, ADC_HIRES_RESOLUTION - 1] of an attached analog pin (never blocks)
+//
+int adc_read_hires(byte pin)
+{
+  int value;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    value = adcSamples[adcFront][ADC_CHANNEL(pin)];
+  }
+  return value;
+}
+
+//
+//  Last decimated value [0, ADC_RESOLUTION - 1] of an attached analog pin (never blocks)
+//
+int adc_read(byte pin)
+{
+  return adc_read_hires(pin) >> ADC_OVERSAMPLING_BITS;
+}
+
+//
+//  Sequence number of the set read by adc_read(), changes when a new set is available
+//
+byte adc_set()
+{
+  return adcSet;
+}
+
+//
+//  Request a single conversion [0, ADC_RESOLUTION - 1] of any analog pin (never blocks)
+//
+void adc_probe(byte pin)
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    adcProbeValue = -1;
+    adcProbe      = ADC_CHANNEL(pin);
+    if (!(ADCSRA & (1 << ADIE))) {                // scanner stopped: convert the probe alone
+      adcProbing = true;
+      adc_select(adcProbe);
+      ADCSRA = (1 << ADEN) | (1 << ADIF) | (1 << ADIE) | ADC_PRESCALER;
+      ADCSRA |= (1 << ADSC);
+    }
+  }
+}
+
+//
+//  Result of the last adc_probe(), -1 if not yet available
+//
+int adc_probe_result()
+{
+  int value;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    value = adcProbeValue;
+  }
+  return value;
+}
+
+//
+//  Store the conversion result and start the next one (interrupt only)
+//
+void adc_sample()
+{
+  byte n    = adcNext;
+  byte back = adcFront ^ 1;
+
+  if (adcProbing) {
+    adcProbeValue = ADC;
+    adcProbe      = 0xFF;
+    adcProbing    = false;
+    if (adcChannelsCount == 0) {                  // nothing else to convert
+      ADCSRA &= ~(1 << ADIE);
+      return;
+    }
+    adc_select(adcChannels[n]);
+    ADCSRA |= (1 << ADSC);
+    return;
+  }
+
+  adcSum[adcChannels[n]] += ADC;
+  if (++n == adcChannelsCount) {
+    n = 0;
+    if (++adcSweeps == ADC_OVERSAMPLING) {        // set completed
+      for (byte i = 0; i < adcChannelsCount; i++) {
+        adcSamples[back][adcChannels[i]] = adcSum[adcChannels[i]] >> ADC_OVERSAMPLING_BITS;
+        adcSum[adcChannels[i]] = 0;
+      }
+      adcSweeps = 0;
+      adcFront  = back;
+      adcSet++;
+    }
+  }
+  adcNext = n;
+  if (n == 0 && adcProbe != 0xFF) {               // probe between two sweeps
+    adcProbing = true;
+    adc_select(adcProbe);
+  }
+  else adc_select(adcChannels[n]);
+  ADCSRA |= (1 << ADSC);
+}
+
+ISR(ADC_vect)
+{
+  adc_sample();
+}
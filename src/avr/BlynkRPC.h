@@ -411,7 +411,7 @@ BLYNK_WRITE(BLYNK_BANK) {
   PRINT_VIRTUAL_PIN(request.pin);
   DPRINTF(" - Bank ");
   DPRINTLN(bank);
-  currentBank = constrain(bank - 1, 0, BANKS - 1);
+  bank_select(constrain(bank - 1, 0, BANKS - 1));
   blynk_refresh_bank();
 }
 
@@ -432,8 +432,20 @@ BLYNK_WRITE(BLYNK_MIDIMESSAGE) {
     case 4:
       DPRINTLNF("Pitch Bend");
       break;
+    case 5:
+      DPRINTLNF("Control Change 14-bit");
+      break;
+    case 6:
+      DPRINTLNF("Pitch Bend 14-bit");
+      break;
+    case 7:
+      DPRINTLNF("Control Change Relative");
+      break;
+    case 8:
+      DPRINTLNF("Macro");
+      break;
   }
-  banks[currentBank][currentPedal].midiMessage = constrain(msg - 1, 0, 3);
+  banks[currentBank][currentPedal].midiMessage = constrain(msg - 1, 0, PED_MACRO);
 }
 
 BLYNK_WRITE(BLYNK_MIDICHANNEL) {
@@ -535,6 +547,7 @@ BLYNK_WRITE(BLYNK_PEDAL_FUNCTION) {
   DPRINTF(" - Function ");
   DPRINTLN(function);
   pedals[currentPedal].function = function - 1;
+  pedal_handlers_setup();
 }
 
 BLYNK_WRITE(BLYNK_PEDAL_AUTOSENSING) {
@@ -551,6 +564,7 @@ BLYNK_WRITE(BLYNK_PEDAL_POLARITY) {
   DPRINTF(" - Polarity ");
   DPRINTLN(polarity);
   pedals[currentPedal].invertPolarity = polarity;
+  pedal_handlers_setup();
 }
 
 BLYNK_WRITE(BLYNK_PEDAL_CALIBRATE) {
@@ -620,6 +634,7 @@ BLYNK_WRITE(BLYNK_INTERFACE_MIDIOUT) {
   DPRINTF(" - MIDI OUT ");
   DPRINTLN(onoff);
   interfaces[currentInterface].midiOut = onoff;
+  midi_ports_setup();
 }
 
 BLYNK_WRITE(BLYNK_INTERFACE_MIDITHRU) {
@@ -636,6 +651,7 @@ BLYNK_WRITE(BLYNK_INTERFACE_MIDIROUTING) {
   DPRINTF(" - MIDI Routing ");
   DPRINTLN(onoff);
   interfaces[currentInterface].midiRouting = onoff;
+  midi_ports_setup();
 }
 
 BLYNK_WRITE(BLYNK_INTERFACE_MIDICLOCK) {
@@ -644,6 +660,7 @@ BLYNK_WRITE(BLYNK_INTERFACE_MIDICLOCK) {
   DPRINTF(" - MIDI Clock ");
   DPRINTLN(onoff);
   interfaces[currentInterface].midiClock = onoff;
+  midi_ports_setup();
 }
 
 BLYNK_WRITE(BLYNK_SSID) {
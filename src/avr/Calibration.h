@@ -0,0 +1,141 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+//
+//  Continuous calibration of analog pedals
+//
+//  expZero and expMax are the 10-bit ends of the pedal travel. For each pedal the oversampled
+//  ends, the range and the scale factor ((MIDI_RESOLUTION_14BIT - 1) << CALIBRATION_SCALE_BITS)
+//  / range are computed once when the ends change, so every sample is mapped to 14-bit with a
+//  single multiply and shift.
+//
+//  With autosensing enabled the ends follow the pedal, as before 10% inside the extreme values
+//  reached. The thresholds of the inputs that move them are precomputed too, so a sample
+//  within the current range costs two comparisons. A sample beyond a threshold moves the end
+//  only when:
+//  - it is beyond by more than CALIBRATION_HYSTERESIS (noise around an end does not creep it)
+//  - CALIBRATION_SPIKE_SAMPLES consecutive sets of the analog scanner agree, and the end moves
+//    to the least extreme of them (a single spike is ignored)
+//  Ends only expand: a pedal never reaching an end again is indistinguishable from a player
+//  not pushing it all the way. Learned ends are written to EEPROM by update_learned_eeprom()
+//  CALIBRATION_SAVE_DELAY ms after the last change, so a sweep costs a single write.
+//
+
+#define CALIBRATION_SCALE_BITS      16
+#define CALIBRATION_HYSTERESIS      (2 << ADC_OVERSAMPLING_BITS)   // 2 LSB of the 10-bit value
+#define CALIBRATION_SPIKE_SAMPLES   3
+#define CALIBRATION_SAVE_DELAY      30000                           // ms
+
+struct calibration {
+  int                    zero;                  // expZero of the precomputed values
+  int                    full;                  // expMax of the precomputed values
+  unsigned int           low;                   // oversampled zero
+  unsigned int           range;                 // oversampled range, at least 1
+  unsigned long          scale;                 // 14-bit output per unit of range << CALIBRATION_SCALE_BITS
+  unsigned int           lowTrigger;            // oversampled inputs below it move zero
+  unsigned int           highTrigger;           // oversampled inputs above it move max
+  unsigned int           lowCandidate;          // least extreme input below lowTrigger
+  unsigned int           highCandidate;         // least extreme input above highTrigger
+  byte                   lowCount;              // consecutive sets below lowTrigger
+  byte                   highCount;             // consecutive sets above highTrigger
+  byte                   set;                   // last analog scanner set tracked
+};
+
+calibration       calibrations[PEDALS];
+unsigned int      calibrationDirty    = 0;      // pedals with ends not yet in EEPROM (bit mask)
+unsigned long     calibrationChanged  = 0;      // millis() of the last change
+
+//
+//  Precompute the scale factor and the thresholds of the current ends
+//
+void calibration_setup(byte p)
+{
+  calibration  &c    = calibrations[p];
+  unsigned int  full = pedals[p].expMax << ADC_OVERSAMPLING_BITS;
+
+  c.zero  = pedals[p].expZero;
+  c.full  = pedals[p].expMax;
+  c.low   = c.zero << ADC_OVERSAMPLING_BITS;
+  c.range = (full > c.low) ? full - c.low : 1;
+  c.scale = (((unsigned long)(MIDI_RESOLUTION_14BIT - 1) << CALIBRATION_SCALE_BITS) + c.range - 1) / c.range;
+
+  // Inverse of zero = 1.1 * input and max = 0.9 * input, beyond the hysteresis
+  c.lowTrigger  = (c.low > CALIBRATION_HYSTERESIS) ? (c.low - CALIBRATION_HYSTERESIS) * 10UL / 11 : 0;
+  c.highTrigger = min((full + CALIBRATION_HYSTERESIS) * 10UL / 9, (unsigned long)ADC_HIRES_RESOLUTION);
+  c.lowCount    = 0;
+  c.highCount   = 0;
+}
+
+//
+//  Map an oversampled analog value [0, ADC_HIRES_RESOLUTION - 1] to [0, MIDI_RESOLUTION_14BIT - 1]
+//
+unsigned int calibration_scale(byte p, unsigned int value)
+{
+  calibration &c = calibrations[p];
+
+  if (c.zero != pedals[p].expZero || c.full != pedals[p].expMax) calibration_setup(p);  // ends changed elsewhere
+  if (value <= c.low) return 0;
+  value -= c.low;
+  if (value >= c.range) return MIDI_RESOLUTION_14BIT - 1;
+  return (value * c.scale) >> CALIBRATION_SCALE_BITS;
+}
+
+//
+//  Track the ends of an analog pedal with a new oversampled value
+//
+void calibration_track(byte p, unsigned int value)
+{
+  calibration &c = calibrations[p];
+  byte         set;
+
+  if (c.zero != pedals[p].expZero || c.full != pedals[p].expMax) calibration_setup(p);
+  if (value >= c.lowTrigger && value <= c.highTrigger) {  // within the current ends
+    c.lowCount  = 0;
+    c.highCount = 0;
+    return;
+  }
+
+  set = adc_set();
+  if (set == c.set) return;                               // same value of the previous call
+  c.set = set;
+
+  if (value < c.lowTrigger) {
+    c.lowCandidate = (c.lowCount == 0) ? value : max(c.lowCandidate, value);
+    if (++c.lowCount >= CALIBRATION_SPIKE_SAMPLES) {
+      pedals[p].expZero = (c.lowCandidate + c.lowCandidate / 10) >> ADC_OVERSAMPLING_BITS;
+      DPRINTF("Pedal ");
+      if (p < 9) DPRINTF(" ");
+      DPRINT(p + 1);
+      DPRINTF(" calibration min ");
+      DPRINT(pedals[p].expZero);
+      DPRINTLNF("");
+      calibration_setup(p);
+      calibrationDirty  |= (1U << p);
+      calibrationChanged = millis();
+    }
+  }
+  else c.lowCount = 0;
+
+  if (value > c.highTrigger) {
+    c.highCandidate = (c.highCount == 0) ? value : min(c.highCandidate, value);
+    if (++c.highCount >= CALIBRATION_SPIKE_SAMPLES) {
+      pedals[p].expMax = (c.highCandidate - c.highCandidate / 10) >> ADC_OVERSAMPLING_BITS;
+      DPRINTF("Pedal ");
+      if (p < 9) DPRINTF(" ");
+      DPRINT(p + 1);
+      DPRINTF(" calibration max ");
+      DPRINT(pedals[p].expMax);
+      DPRINTLNF("");
+      calibration_setup(p);
+      calibrationDirty  |= (1U << p);
+      calibrationChanged = millis();
+    }
+  }
+  else c.highCount = 0;
+}
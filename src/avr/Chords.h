@@ -0,0 +1,101 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Chords
+//
+//  A chord is a set of pedals pressed together (chords[], saved in EEPROM) with its own list of
+//  messages. Only single press switches take part: their tip contacts are routed to the chord
+//  layer, which holds their changes for CHORD_WINDOW ms after the first press. If the pedals
+//  held down together after the last press of the window are exactly the pedals of a chord, the
+//  chord messages are sent and the held changes are dropped, otherwise the held changes are
+//  replayed in order. Pedals pressed one after the other, each released before the next one,
+//  never make a chord. The first release of a pedal of the chord sent ends its notes (note off
+//  of its note on messages). Either way the chord pedals go straight through again once all of
+//  them are released.
+//
+//  chord_setup() compiles every chord into a contacts word, so matching the window is a single
+//  compare per chord. Pedals not used by any chord never wait. When the chord contacts change
+//  (a pedal setup changed while playing) the window open is closed as on its timeout and the
+//  notes of the chord sent are ended before the new chords take over.
+//
+
+#define CHORD_WINDOW        40                  // ms after the first press
+#define CHORD_HELD          8                   // changes held in the window
+
+#define CHORD_IDLE          0                   // no chord pedal pressed
+#define CHORD_HOLD          1                   // window open, changes held
+#define CHORD_MATCHED       2                   // chord sent, changes dropped until all released
+#define CHORD_PASS          3                   // no chord, changes go through until all released
+
+contacts_t        chordMask[CHORDS];            // tip contacts of each chord, 0 = disabled
+contacts_t        chordContacts   = 0;          // tip contacts of all the chords
+contacts_t        chordInvert     = 0;          // chord contacts with inverted polarity
+contacts_t        chordPressed    = 0;          // chord contacts pressed at the last change of the window
+byte              chordFound      = CHORDS;     // chord of the pedals down together in the window
+byte              chordSent       = CHORDS;     // chord sent, until the release of one of its pedals
+byte              chordState      = CHORD_IDLE;
+unsigned long     chordStart;                   // millis() of the first press of the window
+pedal_event       chordHeld[CHORD_HELD];
+byte              chordHeldCount  = 0;
+
+void midi_chord_close(bool send);
+void midi_chord_send(byte c, unsigned long edge, bool on_off, bool send);
+
+//
+//  Compile the chords of the pedals available (contacts of the single press switches), a
+//  window in progress survives when the chord pedals are the same
+//
+void chord_setup(contacts_t available, contacts_t invert)
+{
+  contacts_t mask[CHORDS];
+  contacts_t contacts = 0;
+
+  for (byte c = 0; c < CHORDS; c++) {
+    mask[c] = 0;
+    if (chords[c].messages == 0) continue;
+    for (byte p = 0; p < PEDALS; p++)
+      if (chords[c].pedals & (1U << p)) mask[c] |= CONTACT_BIT(CONTACT_TIP(p));
+    if ((mask[c] & ~available) || !(mask[c] & (mask[c] - 1))) {
+      mask[c] = 0;                                      // pedal not available or single pedal
+      continue;
+    }
+    contacts |= mask[c];
+  }
+  if (contacts != chordContacts) {                      // flush with the old chords
+    if (chordState == CHORD_HOLD) midi_chord_close(true);
+    if (chordSent < CHORDS) midi_chord_send(chordSent, micros(), false, true);
+    chordState     = CHORD_IDLE;
+    chordHeldCount = 0;
+    chordSent      = CHORDS;
+  }
+  memcpy(chordMask, mask, sizeof(chordMask));
+  chordContacts = contacts;
+  chordInvert   = invert & chordContacts;
+}
+
+//
+//  Chord contacts pressed in a contacts word
+//
+contacts_t chord_pressed(contacts_t state)
+{
+  return ~(state ^ chordInvert) & chordContacts;
+}
+
+//
+//  Chord of exactly the pedals of a contacts word, CHORDS if none
+//
+byte chord_match(contacts_t pressed)
+{
+  if (pressed == 0) return CHORDS;
+  for (byte c = 0; c < CHORDS; c++)
+    if (chordMask[c] == pressed) return c;
+  return CHORDS;
+}
@@ -9,7 +9,38 @@
  */
 
 #define SIGNATURE "Pedalino(TM)"
-#define EEPROM_VERSION 11 // Increment each time you change the eeprom structure
+#define EEPROM_VERSION 22 // Increment each time you change the eeprom structure
+
+//
+//  EEPROM layout: header (signature, version and current profile), PROFILES profile slots and
+//  the shared block. The shared block holds the ladder layouts: they describe the buttons wired
+//  to a jack, not a setup, so they do not change with the profile.
+//  EEPROM_PROFILE_SIZE adds up the fields written by update_eeprom(), in the same order: keep
+//  them in step, the build fails when a profile no longer fits its slot. Multi-byte fields are
+//  fixed width so the host simulator has the layout of the board.
+//  The MEGA fits 3 profiles of 1277 bytes (slots of 1309) next to 4 shared ladders, with 8
+//  chords packed in 12 bytes each: a larger table must be paid for by a smaller one.
+//
+#define EEPROM_HEADER_SIZE    (sizeof(SIGNATURE) + 2 * sizeof(byte))
+#define EEPROM_SHARED_SIZE    (LADDERS * sizeof(ladder))
+#define EEPROM_PROFILE_SLOT   ((E2END + 1 - EEPROM_HEADER_SIZE - EEPROM_SHARED_SIZE) / PROFILES)
+#define EEPROM_SHARED         (EEPROM_HEADER_SIZE + PROFILES * EEPROM_PROFILE_SLOT)
+#define EEPROM_PEDAL_SIZE     (sizeof(uint16_t) + CURVE_USER_POINTS + 2 * sizeof(uint16_t) + 2 * sizeof(byte))
+#ifdef NOLCD
+#define EEPROM_DISPLAY_SIZE   0
+#else
+#define EEPROM_DISPLAY_SIZE   (sizeof(byte) + IR_CUSTOM_CODES * sizeof(uint32_t))
+#endif
+#define EEPROM_PROFILE_SIZE   (sizeof(SIGNATURE) + sizeof(byte) +       \
+                               BANKS * PEDALS * 5 * sizeof(byte) +      \
+                               PEDALS * EEPROM_PEDAL_SIZE +             \
+                               CHORDS * sizeof(chord) +                 \
+                               MACROS * sizeof(macro) +                 \
+                               INTERFACES * 5 * sizeof(byte) +          \
+                               4 * sizeof(byte) +                       \
+                               EEPROM_DISPLAY_SIZE)
+
+static_assert(EEPROM_PROFILE_SIZE <= EEPROM_PROFILE_SLOT, "profile does not fit its EEPROM slot");
 
 //
 //  Load factory deafult value for banks, pedals and interfaces
@@ -59,18 +90,20 @@ void load_factory_default()
 
   for (byte p = 0; p < PEDALS; p++)
     pedals[p] = {PED_MIDI,       // function
-                 1,              // autosensing disabled
+                 1,              // autosensing enabled
                  PED_MOMENTARY1, // mode
                  PED_PRESS_1,    // press mode
-                 0,              // invert polarity disabled
-                 0,              // map function
+                 DEBOUNCE_BOUNCE_MAX,  // contact bounce, unlearned
                  50,             // expression pedal zero
+                 0,              // speculative single press disabled
+                 0,              // invert polarity disabled
+                 filter_tuning_step(FILTER_DEFAULT_CUTOFF), // smoothing at rest
                  930,            // expression pedal max
-                 0,              // last state of switch 1
-                 0,              // last state of switch 2
-                 millis(),       // last time switch 1 status changed
-                 millis(),       // last time switch 2 status changed
-                 nullptr, nullptr, nullptr, nullptr, nullptr};
+                 0,              // map function
+                 filter_tuning_step(FILTER_DEFAULT_BETA),   // smoothing speed boost
+                 {0, 64, 128, 191, 255}};  // custom response curve (linear)
+  for (byte p = 0; p < PEDALS; p++)
+    pedalStates[p] = {{0, 0}, (uint16_t)millis()};
   pedals[0].function = PED_MENU;
   pedals[0].mode = PED_LADDER;
   /*
@@ -93,6 +126,15 @@ void load_factory_default()
   pedals[15].function = PED_MIDI;
   pedals[15].mode = PED_ANALOG;
 
+  for (byte l = 0; l < LADDERS; l++)
+    ladders[l] = {0xFF, 0, {0}, {0}};
+
+  for (byte c = 0; c < CHORDS; c++)
+    chords[c] = {0, 0, {{0}}};
+
+  for (byte m = 0; m < MACROS; m++)
+    macros[m] = {0, {{0}}};
+
   for (byte i = 0; i < INTERFACES; i++)
     interfaces[i] = {
         PED_ENABLE,  // MIDI IN
@@ -106,6 +148,33 @@ void load_factory_default()
   for (byte c = 0; c < IR_CUSTOM_CODES; c++)
     ircustomcode[c] = 0xFFFFFE;
 #endif
+
+  midi_ports_setup();
+}
+
+//
+//  Pedal setup fields saved in a single word
+//
+uint16_t eeprom_pedal_setup(byte p)
+{
+  return  (uint16_t)pedals[p].function              |
+         ((uint16_t)pedals[p].autoSensing    <<  4) |
+         ((uint16_t)pedals[p].mode           <<  5) |
+         ((uint16_t)pedals[p].pressMode      <<  8) |
+         ((uint16_t)pedals[p].speculative    << 11) |
+         ((uint16_t)pedals[p].invertPolarity << 12) |
+         ((uint16_t)pedals[p].mapFunction    << 13);
+}
+
+void eeprom_pedal_load(byte p, uint16_t setup)
+{
+  pedals[p].function       =  setup        & 0x0F;
+  pedals[p].autoSensing    = (setup >>  4) & 0x01;
+  pedals[p].mode           = (setup >>  5) & 0x07;
+  pedals[p].pressMode      = (setup >>  8) & 0x07;
+  pedals[p].speculative    = (setup >> 11) & 0x01;
+  pedals[p].invertPolarity = (setup >> 12) & 0x01;
+  pedals[p].mapFunction    = (setup >> 13) & 0x03;
 }
 
 //
@@ -154,7 +223,7 @@ void update_eeprom()
   DPRINTLN2(currentProfile, HEX);
 
   // Jump to profile
-  offset += currentProfile * EEPROM.length() / PROFILES;
+  offset += currentProfile * EEPROM_PROFILE_SLOT;
 
   EEPROM.put(offset, SIGNATURE);
   offset += sizeof(SIGNATURE);
@@ -164,9 +233,7 @@ void update_eeprom()
   for (byte b = 0; b < BANKS; b++)
     for (byte p = 0; p < PEDALS; p++)
     {
-      EEPROM.put(offset, banks[b][p].midiMessage);
-      offset += sizeof(byte);
-      EEPROM.put(offset, banks[b][p].midiChannel);
+      EEPROM.put(offset, (byte)((banks[b][p].midiMessage << 4) | ((banks[b][p].midiChannel - 1) & 0x0F)));
       offset += sizeof(byte);
       EEPROM.put(offset, banks[b][p].midiCode);
       offset += sizeof(byte);
@@ -180,22 +247,30 @@ void update_eeprom()
 
   for (byte p = 0; p < PEDALS; p++)
   {
-    EEPROM.put(offset, pedals[p].function);
-    offset += sizeof(byte);
-    EEPROM.put(offset, pedals[p].autoSensing);
-    offset += sizeof(byte);
-    EEPROM.put(offset, pedals[p].mode);
+    EEPROM.put(offset, eeprom_pedal_setup(p));
+    offset += sizeof(uint16_t);
+    EEPROM.put(offset, pedals[p].curve);
+    offset += sizeof(pedals[p].curve);
+    EEPROM.put(offset, (uint16_t)pedals[p].expZero);
+    offset += sizeof(uint16_t);
+    EEPROM.put(offset, (uint16_t)pedals[p].expMax);
+    offset += sizeof(uint16_t);
+    EEPROM.update(offset, pedals[p].bounceTime);
     offset += sizeof(byte);
-    EEPROM.put(offset, pedals[p].pressMode);
+    EEPROM.update(offset, (byte)((pedals[p].filterBeta << 4) | pedals[p].filterCutoff));
     offset += sizeof(byte);
-    EEPROM.put(offset, pedals[p].invertPolarity);
-    offset += sizeof(byte);
-    EEPROM.put(offset, pedals[p].mapFunction);
-    offset += sizeof(byte);
-    EEPROM.put(offset, pedals[p].expZero);
-    offset += sizeof(int);
-    EEPROM.put(offset, pedals[p].expMax);
-    offset += sizeof(int);
+  }
+
+  for (byte c = 0; c < CHORDS; c++)
+  {
+    EEPROM.put(offset, chords[c]);
+    offset += sizeof(chord);
+  }
+
+  for (byte m = 0; m < MACROS; m++)
+  {
+    EEPROM.put(offset, macros[m]);
+    offset += sizeof(macro);
   }
 
   for (byte i = 0; i < INTERFACES; i++)
@@ -255,14 +330,79 @@ void update_eeprom()
 
   for (byte c = 0; c < IR_CUSTOM_CODES; c++)
   {
-    EEPROM.put(offset, ircustomcode[c]);
-    offset += sizeof(unsigned long);
+    EEPROM.put(offset, (uint32_t)ircustomcode[c]);
+    offset += sizeof(uint32_t);
   }
 #endif
 
+  // Shared block
+  offset = EEPROM_SHARED;
+  for (byte l = 0; l < LADDERS; l++)
+  {
+    EEPROM.put(offset, ladders[l]);
+    offset += sizeof(ladder);
+  }
+
+  calibrationDirty = 0;
+  debounceDirty    = 0;
   blynk_refresh();
 }
 
+//
+//  Write the ends learned by the continuous calibration and the contact bounces learned by the
+//  scanner, a while after the last change
+//
+void update_learned_eeprom()
+{
+  int           offset;
+  unsigned int  learned = scanner_learned();
+
+  if (learned) {
+    for (byte p = 0; p < PEDALS; p++)
+      if (learned & (1U << p)) pedals[p].bounceTime = scanBounce[p];
+    debounceDirty  |= learned;
+    debounceChanged = millis();
+  }
+
+  if (calibrationDirty && millis() - calibrationChanged < CALIBRATION_SAVE_DELAY) return;
+  if (debounceDirty    && millis() - debounceChanged    < CALIBRATION_SAVE_DELAY) return;
+  if ((calibrationDirty | debounceDirty) == 0) return;
+
+  // Same layout of update_eeprom()
+  offset  = EEPROM_HEADER_SIZE;
+  offset += currentProfile * EEPROM_PROFILE_SLOT;
+  offset += sizeof(SIGNATURE) + sizeof(byte);
+  offset += BANKS * PEDALS * 5 * sizeof(byte);
+
+  for (byte p = 0; p < PEDALS; p++) {
+    offset += sizeof(uint16_t) + sizeof(pedals[p].curve);
+    if (calibrationDirty & (1U << p)) {
+      DPRINTF("Updating EEPROM calibration of pedal ");
+      DPRINTLN(p + 1);
+      EEPROM.put(offset, (uint16_t)pedals[p].expZero);
+      EEPROM.put(offset + sizeof(uint16_t), (uint16_t)pedals[p].expMax);
+    }
+    if (debounceDirty & (1U << p)) {
+      DPRINTF("Updating EEPROM contact bounce of pedal ");
+      DPRINTLN(p + 1);
+      EEPROM.update(offset + 2 * sizeof(uint16_t), pedals[p].bounceTime);
+    }
+    offset += EEPROM_PEDAL_SIZE - sizeof(uint16_t) - sizeof(pedals[p].curve);
+  }
+  calibrationDirty = 0;
+  debounceDirty    = 0;
+}
+
+//
+//  Read a word from EEPROM (bit-packed fields cannot be bound to EEPROM.get())
+//
+uint16_t eeprom_get_word(int offset)
+{
+  uint16_t value;
+
+  return EEPROM.get(offset, value);
+}
+
 //
 //  Read configuration from EEPROM
 //
@@ -298,8 +438,12 @@ void read_eeprom()
   DPRINTF("Current profile:   0x");
   DPRINTLN2(currentProfile, HEX);
 
+  // Shared block
+  for (byte l = 0; l < LADDERS; l++)
+    EEPROM.get(EEPROM_SHARED + l * sizeof(ladder), ladders[l]);
+
   // Jump to profile
-  offset += currentProfile * EEPROM.length() / PROFILES;
+  offset += currentProfile * EEPROM_PROFILE_SLOT;
 
   EEPROM.get(offset, signature);
   offset += sizeof(SIGNATURE);
@@ -312,9 +456,9 @@ void read_eeprom()
   for (byte b = 0; b < BANKS; b++)
     for (byte p = 0; p < PEDALS; p++)
     {
-      EEPROM.get(offset, banks[b][p].midiMessage);
-      offset += sizeof(byte);
-      EEPROM.get(offset, banks[b][p].midiChannel);
+      EEPROM.get(offset, banks[b][p].midiMessage);                // message and channel share a byte
+      banks[b][p].midiChannel = (banks[b][p].midiMessage & 0x0F) + 1;
+      banks[b][p].midiMessage = banks[b][p].midiMessage >> 4;
       offset += sizeof(byte);
       EEPROM.get(offset, banks[b][p].midiCode);
       offset += sizeof(byte);
@@ -328,22 +472,33 @@ void read_eeprom()
 
   for (byte p = 0; p < PEDALS; p++)
   {
-    EEPROM.get(offset, pedals[p].function);
-    offset += sizeof(byte);
-    EEPROM.get(offset, pedals[p].autoSensing);
-    offset += sizeof(byte);
-    EEPROM.get(offset, pedals[p].mode);
+    eeprom_pedal_load(p, eeprom_get_word(offset));
+    offset += sizeof(uint16_t);
+    EEPROM.get(offset, pedals[p].curve);
+    offset += sizeof(pedals[p].curve);
+    pedals[p].expZero = eeprom_get_word(offset);
+    offset += sizeof(uint16_t);
+    pedals[p].expMax = eeprom_get_word(offset);
+    offset += sizeof(uint16_t);
+    pedals[p].bounceTime = constrain(EEPROM.read(offset), 0, DEBOUNCE_BOUNCE_MAX);
     offset += sizeof(byte);
-    EEPROM.get(offset, pedals[p].pressMode);
+    pedals[p].filterCutoff = EEPROM.read(offset) & 0x0F;          // cutoff and beta steps share a byte
+    pedals[p].filterBeta   = EEPROM.read(offset) >> 4;
     offset += sizeof(byte);
-    EEPROM.get(offset, pedals[p].invertPolarity);
-    offset += sizeof(byte);
-    EEPROM.get(offset, pedals[p].mapFunction);
-    offset += sizeof(byte);
-    EEPROM.get(offset, pedals[p].expZero);
-    offset += sizeof(int);
-    EEPROM.get(offset, pedals[p].expMax);
-    offset += sizeof(int);
+  }
+
+  for (byte c = 0; c < CHORDS; c++)
+  {
+    EEPROM.get(offset, chords[c]);
+    offset += sizeof(chord);
+    if (chords[c].messages > CHORD_MESSAGES) chords[c].messages = 0;
+  }
+
+  for (byte m = 0; m < MACROS; m++)
+  {
+    EEPROM.get(offset, macros[m]);
+    offset += sizeof(macro);
+    if (macros[m].messages > MACRO_MESSAGES) macros[m].messages = 0;
   }
 
   for (byte i = 0; i < INTERFACES; i++)
@@ -364,7 +519,7 @@ void read_eeprom()
   DPRINT2(offset, HEX);
   DPRINTF("] ");
   EEPROM.get(offset, currentBank);
-  currentBank = constrain(currentBank, 0, BANKS - 1);
+  bank_select(currentBank);
   offset += sizeof(byte);
   DPRINTF("Current bank:      0x");
   DPRINTLN2(currentBank, HEX);
@@ -406,10 +561,12 @@ void read_eeprom()
 
   for (byte c = 0; c < IR_CUSTOM_CODES; c++)
   {
-    EEPROM.get(offset, ircustomcode[c]);
-    offset += sizeof(unsigned long);
+    uint32_t code;
+    ircustomcode[c] = EEPROM.get(offset, code);
+    offset += sizeof(uint32_t);
   }
 #endif
 
+  midi_ports_setup();
   blynk_refresh();
 }
\ No newline at end of file
@@ -15,102 +15,309 @@
 void screen_info(byte, byte, byte, byte);
 #endif
 
+void pedal_handlers_setup();
+void controller_setup();
+
 //
-//  Autosensing setup
+//  Bank selection
 //
-void autosensing_setup()
+//  A pedal addresses three bank rows: the current bank with the tip, the next one with the ring
+//  and the one after with both (wrapping around). bank_select() is the only way to change
+//  currentBank and resolves the three rows at once, so the handlers index bankRow[] directly
+//  and never see a mix of old and new banks.
+//
+bank         *bankRow[3] = {banks[0], banks[1 % BANKS], banks[2 % BANKS]};
+
+void bank_select(byte b)
 {
-  int tip;    // tip connected to an input digital pin 23, 25, ... 53 with internal pull-up resistor
-  int ring;   // ring connected to an input analog pin A0, A1, ... A15
-  /*        */// sleeve connected to GND
-  int ring_min;
-  int ring_max;
-  Bounce debouncer;
+  currentBank = constrain(b, 0, BANKS - 1);
+  for (byte r = 0; r < 3; r++)
+    bankRow[r] = banks[(currentBank + r) % BANKS];
+}
 
-  return;
+//
+//  Autosensing
+//
+//  Jacks are probed in background, one per time slice, so boot does not wait for them and the
+//  other pedals keep working. At boot every pedal is probed once in a quick pass, then one
+//  pedal every AUTOSENSING_PERIOD ms to detect pedals plugged or unplugged while running.
+//
+//  Only MIDI pedals with autosensing enabled are probed: switches and analog pedals, not the
+//  pedals used to control Pedalino (the menu reads them directly). A pedal in use is skipped.
+//  After the boot pass only the single contact modes (momentary, latch, analog) are probed
+//  again: the ring of a dual switch may be open at any time and must not change its setup.
+//  While probed the pedal is out of service, its handlers skip it and its contacts are left
+//  out of the events, with the tip as input with pull-up and the ring floating:
+//  - ring noisy             -> not connected (tip HIGH, setup kept) or normally closed switch (tip LOW)
+//  - ring connected to GND  -> switch, normally closed if tip LOW
+//  - ring stable above GND  -> analog
+//  A new setup is probed again at once and applied (controller_setup()) only after
+//  AUTOSENSING_CONFIRM probes in a row agree on it.
+//
+#define AUTOSENSING_SLICE         10          // ms between two steps of the boot pass
+#define AUTOSENSING_PERIOD        1000        // ms between two probes while running
+#define AUTOSENSING_QUIET         2000        // ms since the last use to consider a pedal idle
+#define AUTOSENSING_SETTLE        5           // ms for the pins to settle after changing mode
+#define AUTOSENSING_SAMPLES       10          // ring readings per probe
+#define AUTOSENSING_TIMEOUT       50          // ms to wait for a ring reading
+#define AUTOSENSING_RESTORE       (4 * DEBOUNCE_INTERVAL)  // ms before the pedal is in service again
+#define AUTOSENSING_CONFIRM       3           // probes in a row to change the setup of a pedal
+
+#define AUTOSENSING_IDLE          0
+#define AUTOSENSING_SETTLING      1
+#define AUTOSENSING_SAMPLING      2
+#define AUTOSENSING_RESTORING     3
+
+byte          autosensingState    = AUTOSENSING_IDLE;
+byte          autosensingPedal    = 0xFF;     // pedal out of service, 0xFF if none
+contacts_t    autosensingContacts = 0;        // its contacts, left out of the events
+byte          autosensingNext     = 0;        // next pedal to probe
+bool          autosensingBoot     = true;     // first pass in progress
+unsigned long autosensingTime     = 0;        // millis() of the last step
+byte          autosensingCount    = 0;        // ring readings done
+int           autosensingRingMin;
+int           autosensingRingMax;
+byte          autosensingTip;
+byte          autosensingSuggested = 0xFF;    // pedal with a new setup to confirm, 0xFF if none
+byte          autosensingMode;                // its new setup
+bool          autosensingInvert;
+byte          autosensingMatches  = 0;        // probes in a row that found it
 
+//
+//  Start the first pass
+//
+void autosensing_setup()
+{
+  autosensingState     = AUTOSENSING_IDLE;
+  autosensingPedal     = 0xFF;
+  autosensingContacts  = 0;
+  autosensingNext      = 0;
+  autosensingBoot      = true;
+  autosensingSuggested = 0xFF;
+  autosensingMatches   = 0;
+  autosensingTime      = millis();
   DPRINTLNF("Pedal autosensing...");
+}
 
-  for (byte p = 0; p < PEDALS; p++) {
-    pinMode(PIN_D(p), INPUT_PULLUP);
-    if (pedals[p].autoSensing) {
-      debouncer.attach(PIN_D(p));
-      debouncer.interval(DEBOUNCE_INTERVAL);
-      debouncer.update();
-      tip = debouncer.read();
+//
+//  Pedal can be probed now
+//
+bool autosensing_probeable(byte p)
+{
+  bool boot = autosensingBoot || p == autosensingSuggested;   // a setup found at boot is confirmed as such
+
+  if (!pedals[p].autoSensing) return false;
+  if (pedals[p].function != PED_MIDI) return false;
+  switch (pedals[p].mode) {
+    case PED_MOMENTARY2:
+    case PED_MOMENTARY3:
+    case PED_LATCH2:
+      if (!boot) return false;                                // the ring may be open while in use
+      // fall through
+    case PED_MOMENTARY1:
+    case PED_LATCH1:
+      if (bitRead(scanner_state(), CONTACT_TIP(p)) == pedals[p].invertPolarity) return false; // pressed
+      break;
+    case PED_ANALOG:
+      break;
+    default:
+      return false;
+  }
+  if (boot) return true;
+  return (pedal_elapsed(p) >= AUTOSENSING_QUIET);
+}
 
-      DPRINTF("Pedal ");
-      if (p < 9) DPRINTF(" ");
-      DPRINT(p + 1);
-      DPRINTF("   Tip Pin ");
-      DPRINT(PIN_D(p));
-      DPRINTF(" ");
-      switch (tip) {
-        case LOW:
-          DPRINTF("LOW ");
-          break;
-        case HIGH:
-          DPRINTF("HIGH");
-          break;
-      }
-      DPRINTF("    Ring Pin A");
-      DPRINT(p);
-      if (p < 10) DPRINTF(" ");
-      DPRINTF(" ");
+//
+//  Put the pedal back in service with its own pin setup
+//
+void autosensing_restore(byte p)
+{
+  switch (pedals[p].mode) {
+    case PED_ANALOG:
+      pinMode(PIN_D(p), OUTPUT);
+      digitalWrite(PIN_D(p), HIGH);
+      break;
+    case PED_MOMENTARY2:
+    case PED_MOMENTARY3:
+    case PED_LATCH2:
+      pinMode(PIN_A(p), INPUT_PULLUP);
+      // fall through
+    default:
+      pinMode(PIN_D(p), INPUT_PULLUP);
+      break;
+  }
+}
 
-      ring_min = ADC_RESOLUTION;
-      ring_max = 0;
-      for (int i = 0; i < 10; i++) {
-        ring = analogRead(PIN_A(p));
-        ring_min = min(ring, ring_min);
-        ring_max = max(ring, ring_max);
+//
+//  Setup suggested by the probe in mode and invert, true if different from the current one
+//
+bool autosensing_detect(byte p, byte &mode, bool &invert)
+{
+  bool  analog   = (pedals[p].mode == PED_ANALOG);
+
+  mode   = pedals[p].mode;
+  invert = pedals[p].invertPolarity;
+
+  DPRINTF("Pedal ");
+  if (p < 9) DPRINTF(" ");
+  DPRINT(p + 1);
+  DPRINTF("   Tip Pin ");
+  DPRINT(PIN_D(p));
+  if (autosensingTip == LOW) DPRINTF(" LOW ");
+  else DPRINTF(" HIGH");
+  DPRINTF("    Ring Pin A");
+  DPRINT(p);
+  DPRINTF(" ");
+  DPRINT(autosensingRingMin);
+  DPRINTF("-");
+  DPRINT(autosensingRingMax);
+
+  if ((autosensingRingMax - autosensingRingMin) > 1) {
+    if (autosensingTip == LOW) {
+      // tip connected to GND
+      // switch between tip and ring normally closed
+      analog = false;
+      invert = true;
+      DPRINTLNF(" MOMENTARY POLARITY-");
+    }
+    else {
+      // not connected, nothing to learn until plugged again
+      DPRINTLNF(" FLOATING PIN - NOT CONNECTED ");
+      return false;
+    }
+  }
+  else if (autosensingRingMax <= 1) {
+    // ring connected to sleeve (GND)
+    // switch between tip and ring
+    analog = false;
+    invert = (autosensingTip == LOW);     // switch normally closed
+    DPRINTF(" MOMENTARY");
+    if (invert) DPRINTF(" POLARITY-");
+    DPRINTLNF("");
+  }
+  else {
+    // analog
+    analog = true;
+    invert = true;
+    DPRINTLNF(" ANALOG POLARITY-");
+  }
 
-        DPRINT(ring);
-        DPRINTF(" ");
+  if (analog) mode = PED_ANALOG;
+  else if (mode == PED_ANALOG) mode = PED_MOMENTARY1;
+  return (pedals[p].mode != mode || pedals[p].invertPolarity != invert);
+}
 
-      }
-      if ((ring_max - ring_min) > 1) {
-        if (tip == LOW) {
-          // tip connected to GND
-          // switch between tip and ring normally closed
-          pedals[p].mode = PED_MOMENTARY1;
-          pedals[p].invertPolarity = true;
-          DPRINTLNF(" MOMENTARY POLARITY-");
-        }
-        else {
-          // not connected
-          pedals[p].mode = PED_MOMENTARY1;
-          pedals[p].invertPolarity = false;
-          DPRINTLNF(" FLOATING PIN - NOT CONNECTED ");
+//
+//  Count the probes that agree on a new setup, apply it once confirmed
+//
+bool autosensing_confirm(byte p, byte mode, bool invert)
+{
+  if (p == autosensingSuggested && mode == autosensingMode && invert == autosensingInvert)
+    autosensingMatches++;
+  else {
+    autosensingSuggested = p;
+    autosensingMode      = mode;
+    autosensingInvert    = invert;
+    autosensingMatches   = 1;
+  }
+  if (autosensingMatches < AUTOSENSING_CONFIRM) return false;
+
+  if (mode == PED_ANALOG && pedals[p].mode != PED_ANALOG) {
+    // inititalize continuos calibration
+    pedals[p].expZero = ADC_RESOLUTION - 1;
+    pedals[p].expMax = 0;
+  }
+  pedals[p].mode           = mode;
+  pedals[p].invertPolarity = invert;
+  autosensingSuggested     = 0xFF;
+  autosensingMatches       = 0;
+  return true;
+}
+
+//
+//  One step of the probe in progress, or the start of the next one (main loop only)
+//
+void autosensing_run()
+{
+  byte  p = autosensingPedal;
+  byte  mode;
+  bool  invert;
+  int   ring;
+
+  switch (autosensingState) {
+
+    case AUTOSENSING_IDLE:
+      if (millis() - autosensingTime < (autosensingBoot ? AUTOSENSING_SLICE : AUTOSENSING_PERIOD)) return;
+      autosensingTime = millis();
+      if (autosensingSuggested != 0xFF) p = autosensingSuggested;   // probe it again
+      else {
+        p = autosensingNext;
+        if (++autosensingNext == PEDALS) {
+          autosensingNext = 0;
+          if (autosensingBoot) DPRINTLNF("");
+          autosensingBoot = false;
         }
       }
-      else if (ring <= 1) {
-        // ring connected to sleeve (GND)
-        // switch between tip and ring
-        pedals[p].mode = PED_MOMENTARY1;
-        if (tip == LOW) pedals[p].invertPolarity = true; // switch normally closed
-        DPRINTF(" MOMENTARY");
-        if (pedals[p].invertPolarity) DPRINTF(" POLARITY-");
-        DPRINTLNF("");
+      if (!autosensing_probeable(p)) {
+        autosensingSuggested = 0xFF;              // in use again, start over
+        autosensingMatches   = 0;
+        return;
       }
-      else if (ring > 0) {
-        // analog
-        pedals[p].mode = PED_ANALOG;
-        pedals[p].invertPolarity = true;
-        // inititalize continuos calibration
-        pedals[p].expZero = ADC_RESOLUTION - 1;
-        pedals[p].expMax = 0;
-        DPRINTLNF(" ANALOG POLARITY-");
+      autosensingPedal    = p;                    // out of service
+      autosensingContacts = CONTACT_BIT(CONTACT_TIP(p)) | CONTACT_BIT(CONTACT_RING(p));
+      pinMode(PIN_D(p), INPUT_PULLUP);
+      pinMode(PIN_A(p), INPUT);
+      autosensingState = AUTOSENSING_SETTLING;
+      break;
+
+    case AUTOSENSING_SETTLING:
+      if (millis() - autosensingTime < AUTOSENSING_SETTLE) return;
+      autosensingTip     = digitalRead(PIN_D(p));
+      autosensingRingMin = ADC_RESOLUTION;
+      autosensingRingMax = 0;
+      autosensingCount   = 0;
+      autosensingTime    = millis();
+      adc_probe(PIN_A(p));
+      autosensingState = AUTOSENSING_SAMPLING;
+      break;
+
+    case AUTOSENSING_SAMPLING:
+      ring = adc_probe_result();
+      if (ring < 0) {
+        if (millis() - autosensingTime < AUTOSENSING_TIMEOUT) return;
+        autosensingTime = millis();               // probe cancelled by adc_reset(), ask again
+        adc_probe(PIN_A(p));
+        return;
       }
-    }
-    else {
-      DPRINTF("Pedal ");
-      if (p < 9) DPRINTF(" ");
-      DPRINT(p + 1);
-      DPRINTLNF("   autosensing disabled");
-    }
+      autosensingRingMin = min(ring, autosensingRingMin);
+      autosensingRingMax = max(ring, autosensingRingMax);
+      if (++autosensingCount < AUTOSENSING_SAMPLES) {
+        autosensingTime = millis();
+        adc_probe(PIN_A(p));
+        return;
+      }
+      if (!autosensing_detect(p, mode, invert)) {
+        autosensingSuggested = 0xFF;
+        autosensingMatches   = 0;
+      }
+      else if (autosensing_confirm(p, mode, invert)) {
+        autosensingTime = millis();
+        controller_setup();                       // back in service with the new setup
+        return;
+      }
+      autosensing_restore(p);
+      autosensingTime  = millis();
+      autosensingState = AUTOSENSING_RESTORING;
+      break;
+
+    case AUTOSENSING_RESTORING:
+      if (millis() - autosensingTime < AUTOSENSING_RESTORE) return;
+      autosensingPedal    = 0xFF;                 // back in service
+      autosensingContacts = 0;
+      autosensingTime     = millis();
+      autosensingState = AUTOSENSING_IDLE;
+      break;
   }
-  DPRINTLNF("");
 }
 
 byte map_digital(byte p, byte value)
@@ -119,87 +326,213 @@ byte map_digital(byte p, byte value)
   return value;
 }
 
+//
+//  Map an oversampled analog value [0, ADC_HIRES_RESOLUTION - 1] to [0, MIDI_RESOLUTION_14BIT - 1]
+//
 unsigned int map_analog(byte p, unsigned int value)
 {
   p = constrain(p, 0, PEDALS - 1);
-  value = constrain(value, pedals[p].expZero, pedals[p].expMax);                  // make sure that the analog value is between the minimum and maximum value
-  value = map(value, pedals[p].expZero, pedals[p].expMax, 0, ADC_RESOLUTION - 1); // map the value from [minimumValue, maximumValue] to [0, 1023]
+  value = calibration_scale(p, value);                                        // map the value from [minimumValue, maximumValue] to [0, 16383]
   switch (pedals[p].mapFunction) {
     case PED_LINEAR:
       break;
     case PED_LOG:
-      value = round(log(value + 1) * 147.61);             // y=log(x+1)/log(1023)*1023
+      value = curve_lookup(curveLog, value, curveLogHead);
       break;
     case PED_ANTILOG:
-      value = round((exp(value / 511.5) - 1) * 160.12);   // y=[e^(2*x/1023)-1]/[e^2-1]*1023
+      value = curve_lookup(curveAntiLog, value);
+      break;
+    case PED_CUSTOM:
+      value = curve_user(pedals[p].curve, value);
       break;
   }
   return value;
 }
 
+//
+//  14-bit output rate adaptation
+//
+//  A 14-bit update takes 6 bytes (Control Code MSB and LSB) or 3 bytes (Pitch Bend) on the
+//  31250 baud DIN port, 320 us each. When DIN output is enabled, 14-bit updates are spaced so
+//  that they use at most 1/MIDI_14BIT_DIN_SHARE of its bandwidth: the pedal keeps the latest
+//  value and sends it when the port is ready again.
+//
+#define MIDI_DIN_BYTE_TIME      320       // microseconds to send a byte at 31250 baud
+#define MIDI_14BIT_DIN_SHARE    2
+
+unsigned long midi14BitNext = 0;          // micros() of the next 14-bit update allowed on DIN
+
+//
+//  Edge timestamps to the ESP
+//
+//  While a switch event is sent with a BLE client connected, its first message to the ESP is
+//  preceded by a SysEx with the age of its edge in us (F0 7D <age 0-6> <age 7-13> <age 14-20> F7),
+//  so BLE MIDI can carry the time the pedal moved instead of the time the message crossed the
+//  serial line. The ESP keeps that time for the rest of the event.
+//
+#define MIDI_EDGE_SYSEX_ID      0x7D      // non-commercial manufacturer ID
+#define MIDI_EDGE_AGE_MAX       0x1FFFFFUL
+
+unsigned long midiEdge      = 0;          // micros() of the edge of the switch event being sent
+bool          midiEdgeValid = false;      // edge not sent yet
+
+void midi_edge_begin(unsigned long edge)
+{
+  midiEdge      = edge;
+  midiEdgeValid = true;
+}
+
+void midi_edge_end()
+{
+  midiEdgeValid = false;
+}
+
+//
+//  Pedals output: raw bytes to the ports enabled (midiOutPorts), the edge of the event goes
+//  once to the ESP ahead of its first message, the latency uart stage waits for the last byte
+//
+void midi_out(const byte *message, unsigned int size)
+{
+  if (midiEdgeValid && bleConnected && (midiOutPorts & bit(MIDI_PORT_ESP))) {
+    unsigned long age     = min(micros() - midiEdge, MIDI_EDGE_AGE_MAX);
+    byte          sysex[] = { 0xF0, MIDI_EDGE_SYSEX_ID,
+                              (byte)(age & 0x7F), (byte)((age >> 7) & 0x7F), (byte)(age >> 14), 0xF7 };
+
+    espPort.write(sysex, sizeof(sysex));
+    midiEdgeValid = false;
+  }
+  midi_ports_send(midiOutPorts, message, size);
+  LATENCY_MARK(midiOutPorts);
+}
+
+void midi_out(byte status, byte channel, byte data1, byte data2 = 0)
+{
+  byte message[] = { (byte)(status | ((channel - 1) & 0x0F)), (byte)(data1 & 0x7F), (byte)(data2 & 0x7F) };
+
+  midi_out(message, (status == midi::ProgramChange) ? 2 : 3);
+}
+
+bool midi_is_14bit(byte message)
+{
+  return (message == PED_CONTROL_CHANGE_14BIT || message == PED_PITCH_BEND_14BIT);
+}
+
+//
+//  Messages that tolerate a speculative single press: they set a state that the double or long
+//  press value sent later simply overrides. A note or a relative step would be played twice.
+//
+bool midi_speculative(byte message)
+{
+  return (message == PED_PROGRAM_CHANGE ||
+          message == PED_CONTROL_CHANGE ||
+          message == PED_CONTROL_CHANGE_14BIT ||
+          message == PED_PITCH_BEND ||
+          message == PED_PITCH_BEND_14BIT);
+}
+
+bool midi_ready_14bit()
+{
+  return (!(midiOutPorts & bit(MIDI_PORT_DIN)) || (long)(micros() - midi14BitNext) >= 0);
+}
+
+void midi_send_14bit(byte message, byte code, unsigned int value, byte channel)
+{
+  byte msb = value >> 7;
+  byte lsb = value & 0x7F;
+
+  LATENCY_STAMP(LATENCY_SEND);
+  switch (message) {
+
+    case PED_CONTROL_CHANGE_14BIT:
+
+      if (code >= 32) lsb = 0;                                  // no LSB controller for codes 32-127
+      DPRINTF("     CONTROL CHANGE 14-BIT     Code ");
+      DPRINT(code);
+      DPRINTF("     Value ");
+      DPRINT(value);
+      DPRINTF("     Channel ");
+      DPRINT(channel);
+      midi_out(midi::ControlChange, channel, code, msb);
+      if (code < 32) midi_out(midi::ControlChange, channel, code + 32, lsb);
+      if (midiOutPorts & bit(MIDI_PORT_DIN))
+        midi14BitNext = micros() + (code < 32 ? 6 : 3) * MIDI_DIN_BYTE_TIME * MIDI_14BIT_DIN_SHARE;
+      screen_info(midi::ControlChange, code, msb, channel);
+      break;
+
+    case PED_PITCH_BEND_14BIT:
+
+      DPRINTF("     PITCH BEND 14-BIT     Value ");
+      DPRINT((int)value - MIDI_RESOLUTION_14BIT / 2);
+      DPRINTF("     Channel ");
+      DPRINT(channel);
+      midi_out(midi::PitchBend, channel, lsb, msb);
+      if (midiOutPorts & bit(MIDI_PORT_DIN))
+        midi14BitNext = micros() + 3 * MIDI_DIN_BYTE_TIME * MIDI_14BIT_DIN_SHARE;
+      screen_info(midi::PitchBend, value - MIDI_RESOLUTION_14BIT / 2, 0, channel);
+      break;
+  }
+}
+
+//
+//  Macros: the bytes encoded by macro_setup() go to each port in one queued write
+//
+void midi_send_macro(byte m)
+{
+  if (m >= MACROS || macroBlobSize[m] == 0) return;
+
+  DPRINTF("     MACRO     ");
+  DPRINT(m + 1);
+  DPRINTF("     Messages ");
+  DPRINT(macros[m].messages);
+  midi_out(macroBlob[m], macroBlobSize[m]);
+}
 
 void midi_send(byte message, byte code, byte value, byte channel, bool on_off = true )
 {
+  LATENCY_STAMP(LATENCY_SEND);
   switch (message) {
 
+    case PED_CONTROL_CHANGE_14BIT:
+    case PED_PITCH_BEND_14BIT:
+
+      if (on_off) midi_send_14bit(message, code, map(value, 0, 127, 0, MIDI_RESOLUTION_14BIT - 1), channel);
+      break;
+
     case PED_NOTE_ON_OFF:
 
       if (on_off && value > 0) {
-#ifdef DEBUG_PEDALINO
         DPRINTF("     NOTE ON     Note ");
         DPRINT(code);
         DPRINTF("     Velocity ");
         DPRINT(value);
         DPRINTF("     Channel ");
         DPRINT(channel);
-#else
-        if (interfaces[PED_USBMIDI].midiOut)    USB_MIDI.sendNoteOn(code, value, channel);
-#endif
-        if (interfaces[PED_DINMIDI].midiOut)    DIN_MIDI.sendNoteOn(code, value, channel);
-        if (interfaces[PED_RTPMIDI].midiOut ||
-            interfaces[PED_IPMIDI].midiOut  ||
-            interfaces[PED_BLEMIDI].midiOut ||
-            interfaces[PED_OSC].midiOut)        ESP_MIDI.sendNoteOn(code, value, channel);
+        midi_out(midi::NoteOn, channel, code, value);
         screen_info(midi::NoteOn, code, value, channel);
       }
       else {
-#ifdef DEBUG_PEDALINO
         DPRINTF("     NOTE OFF    Note ");
         DPRINT(code);
         DPRINTF("     Velocity ");
         DPRINT(value);
         DPRINTF("     Channel ");
         DPRINT(channel);
-#else
-        if (interfaces[PED_USBMIDI].midiOut)    USB_MIDI.sendNoteOff(code, value, channel);
-#endif
-        if (interfaces[PED_DINMIDI].midiOut)    DIN_MIDI.sendNoteOff(code, value, channel);
-        if (interfaces[PED_RTPMIDI].midiOut ||
-            interfaces[PED_IPMIDI].midiOut  ||
-            interfaces[PED_BLEMIDI].midiOut ||
-            interfaces[PED_OSC].midiOut)        ESP_MIDI.sendNoteOff(code, value, channel);
+        midi_out(midi::NoteOff, channel, code, value);
         screen_info(midi::NoteOff, code, value, channel);
       }
       break;
 
     case PED_CONTROL_CHANGE:
+    case PED_CONTROL_CHANGE_RELATIVE:
 
       if (on_off) {
-#ifdef DEBUG_PEDALINO
         DPRINTF("     CONTROL CHANGE     Code ");
         DPRINT(code);
         DPRINTF("     Value ");
         DPRINT(value);
         DPRINTF("     Channel ");
         DPRINT(channel);
-#else
-        if (interfaces[PED_USBMIDI].midiOut)    USB_MIDI.sendControlChange(code, value, channel);
-#endif
-        if (interfaces[PED_DINMIDI].midiOut)    DIN_MIDI.sendControlChange(code, value, channel);
-        if (interfaces[PED_RTPMIDI].midiOut ||
-            interfaces[PED_IPMIDI].midiOut  ||
-            interfaces[PED_BLEMIDI].midiOut ||
-            interfaces[PED_OSC].midiOut)        ESP_MIDI.sendControlChange(code, value, channel);
+        midi_out(midi::ControlChange, channel, code, value);
         screen_info(midi::ControlChange, code, value, channel);
       }
       break;
@@ -207,19 +540,11 @@ void midi_send(byte message, byte code, byte value, byte channel, bool on_off =
     case PED_PROGRAM_CHANGE:
 
       if (on_off) {
-#ifdef DEBUG_PEDALINO
         DPRINTF("     PROGRAM CHANGE     Program ");
         DPRINT(code);
         DPRINTF("     Channel ");
         DPRINT(channel);
-#else
-        if (interfaces[PED_USBMIDI].midiOut)    USB_MIDI.sendProgramChange(code, channel);
-#endif
-        if (interfaces[PED_DINMIDI].midiOut)    DIN_MIDI.sendProgramChange(code, channel);
-        if (interfaces[PED_RTPMIDI].midiOut ||
-            interfaces[PED_IPMIDI].midiOut  ||
-            interfaces[PED_BLEMIDI].midiOut ||
-            interfaces[PED_OSC].midiOut)        ESP_MIDI.sendProgramChange(code, channel);
+        midi_out(midi::ProgramChange, channel, code);
         screen_info(midi::ProgramChange, code, 0, channel);
       }
       break;
@@ -227,288 +552,630 @@ void midi_send(byte message, byte code, byte value, byte channel, bool on_off =
     case PED_PITCH_BEND:
 
       if (on_off) {
-        int bend = map(value, 0, 127, - 8192, 8191);
-#ifdef DEBUG_PEDALINO
+        unsigned int bend = map(value, 0, 127, 0, MIDI_RESOLUTION_14BIT - 1);
         DPRINTF("     PITCH BEND     Value ");
-        DPRINT(bend);
+        DPRINT((int)bend - MIDI_RESOLUTION_14BIT / 2);
         DPRINTF("     Channel ");
         DPRINT(channel);
-#else
-        if (interfaces[PED_USBMIDI].midiOut)    USB_MIDI.sendPitchBend(bend, channel);
-#endif
-        if (interfaces[PED_DINMIDI].midiOut)    DIN_MIDI.sendPitchBend(bend, channel);
-        if (interfaces[PED_RTPMIDI].midiOut ||
-            interfaces[PED_IPMIDI].midiOut  ||
-            interfaces[PED_BLEMIDI].midiOut ||
-            interfaces[PED_OSC].midiOut)        ESP_MIDI.sendPitchBend(bend, channel);
-        screen_info(midi::PitchBend, bend, 0, channel);
+        midi_out(midi::PitchBend, channel, bend & 0x7F, bend >> 7);
+        screen_info(midi::PitchBend, bend - MIDI_RESOLUTION_14BIT / 2, 0, channel);
       }
       break;
+
+    case PED_MACRO:
+
+      if (on_off && value > 0) midi_send_macro(value - 1);
+      break;
   }
 }
 
 //
-//  MIDI messages refresh
+//  Pedal handlers
 //
-void midi_refresh(bool send = true)
+//  controller_setup() compiles the configuration of each pedal into compact tables, so
+//  midi_refresh() only visits the active pedals with the right handler:
+//  - single press switches are driven by the scanner events (switchTable[])
+//  - multi press switches and analog pedals are polled every loop (pollTable[])
+//  - chords of single press momentary switches are matched by the chord layer (Chords.h)
+//  Pedals without the MIDI function or without a handler are left out.
+//
+
+typedef void (*pedal_handler)(byte, contacts_t, bool);
+
+struct pedal_switch {
+  byte                   pedal;
+  contacts_t             contacts;        // tip and ring bits in the contacts word
+  byte                   invert;          // 1 = invert polarity
+  bool                   latch;           // send the release message
+};
+
+struct pedal_poll {
+  pedal_handler          handler;
+  byte                   pedal;
+};
+
+pedal_switch  switchTable[PEDALS];
+byte          switchTableCount  = 0;
+contacts_t    switchContacts    = 0;      // all the contacts in switchTable[]
+pedal_poll    pollTable[PEDALS];
+byte          pollTableCount    = 0;
+byte          pressSpeculated[PEDALS];    // contacts with the single press already sent (bit 0 tip, bit 1 ring)
+
+
+//
+//  Single press switches (debounced by the sampling interrupt)
+//
+void midi_refresh_switch(const pedal_switch &s, const pedal_event &e, bool send)
 {
-  MD_UISwitch::keyResult_t  k, k1, k2;
+  byte                      i = s.pedal;
   bool                      state1, state2;
   unsigned int              input;
   unsigned int              value;
-  byte                      b;
+  const bank               *row;
+
+  state1 = e.changed & CONTACT_BIT(CONTACT_TIP(i));
+  state2 = e.changed & CONTACT_BIT(CONTACT_RING(i));
+  if (state1 && state2) {                                                     // pin state changed
+    input = bitRead(e.state, CONTACT_TIP(i));                                 // reads the updated pin state
+    input ^= s.invert;                                                        // invert the value
+    value = map_digital(i, input);                                            // apply the digital map function to the value
+    LATENCY_STAMP(LATENCY_MAPPED);
+
+    DPRINTLNF("");
+    DPRINTF("Pedal ");
+    if (i < 9) DPRINTF(" ");
+    DPRINT(i + 1);
+    DPRINTF("   input ");
+    DPRINT(input);
+    DPRINTF(" output ");
+    DPRINT(value);
+
+    row = bankRow[2];
+    if (value == LOW)                                                         // LOW = pressed, HIGH = released
+      midi_send(row[i].midiMessage,
+                row[i].midiCode,
+                row[i].midiValue1,
+                row[i].midiChannel);
+    else
+      midi_send(row[i].midiMessage,
+                row[i].midiCode,
+                row[i].midiValue2,
+                row[i].midiChannel,
+                s.latch);
+    pedalStates[i].pedalValue[0] = value;
+    pedalStates[i].pedalValue[1] = pedalStates[i].pedalValue[0];
+    pedal_touch(i, e.time);
+    lastUsedSwitch = i;
+  }
+  else {
+    if (state1) {                                                             // pin state changed
+      input = bitRead(e.state, CONTACT_TIP(i));                               // reads the updated pin state
+      input ^= s.invert;                                                      // invert the value
+      value = map_digital(i, input);                                          // apply the digital map function to the value
+      LATENCY_STAMP(LATENCY_MAPPED);
+
+      DPRINTLNF("");
+      DPRINTF("Pedal ");
+      if (i < 9) DPRINTF(" ");
+      DPRINT(i + 1);
+      DPRINTF("   input ");
+      DPRINT(input);
+      DPRINTF(" output ");
+      DPRINT(value);
+
+      row = bankRow[0];
+      if (value == LOW) {                                                     // LOW = pressed, HIGH = released
+        if (send) midi_send(row[i].midiMessage,
+                            row[i].midiCode,
+                            row[i].midiValue1,
+                            row[i].midiChannel);
+      }
+      else
+        if (send) midi_send(row[i].midiMessage,
+                            row[i].midiCode,
+                            row[i].midiValue2,
+                            row[i].midiChannel,
+                            s.latch);
+      pedalStates[i].pedalValue[0] = value;
+      pedal_touch(i, e.time);
+      lastUsedSwitch = i;
+    }
+    if (state2) {                                                             // pin state changed
+      input = bitRead(e.state, CONTACT_RING(i));                              // reads the updated pin state
+      input ^= s.invert;                                                      // invert the value
+      value = map_digital(i, input);                                          // apply the digital map function to the value
+      LATENCY_STAMP(LATENCY_MAPPED);
+
+      DPRINTLNF("");
+      DPRINTF("Pedal ");
+      if (i < 9) DPRINTF(" ");
+      DPRINT(i + 1);
+      DPRINTF("   input ");
+      DPRINT(input);
+      DPRINTF(" output ");
+      DPRINT(value);
+
+      row = bankRow[1];
+      if (value == LOW) {                                                     // LOW = pressed, HIGH = released
+        if (send) midi_send(row[i].midiMessage,
+                            row[i].midiCode,
+                            row[i].midiValue1,
+                            row[i].midiChannel);
+      }
+      else
+        if (send) midi_send(row[i].midiMessage,
+                            row[i].midiCode,
+                            row[i].midiValue2,
+                            row[i].midiChannel,
+                            s.latch);
+      pedalStates[i].pedalValue[1] = value;
+      pedal_touch(i, e.time);
+      lastUsedSwitch = i;
+    }
+  }
+}
+
+
+//
+//  Multi press switches (single, double and long press detected by MD_UISwitch)
+//
+//  MD_UISwitch reports a single press only when the double press window is over. With the
+//  speculative option the single press value of each contact is sent on the debounced press
+//  instead, and the double or long press value follows once the gesture is resolved. Only
+//  the targets accepted by midi_speculative() are anticipated.
+//
+void midi_refresh_press(byte i, contacts_t state, bool send)
+{
+  MD_UISwitch::keyResult_t  k, k1, k2;
+  const bank               *row;
+  byte                      pressed;
+
+  if (pedals[i].speculative && (pedals[i].pressMode == PED_PRESS_1_2 ||
+                                 pedals[i].pressMode == PED_PRESS_1_L ||
+                                 pedals[i].pressMode == PED_PRESS_1_2_L)) {
+    pressed  = bitRead(state, CONTACT_TIP(i))  ? 0 : 1;
+    pressed |= bitRead(state, CONTACT_RING(i)) ? 0 : 2;
+    if (pedals[i].invertPolarity) pressed ^= 3;
+    for (byte c = 0; c < 2; c++) {
+      if (!(pressed & (1 << c)) || (pressSpeculated[i] & (1 << c))) continue;
+      if (pool_switch(i, c) == nullptr) continue;
+      if ((byte)bitRead(state, CONTACT_TIP(i) + c) == pedalStates[i].pedalValue[c]) continue;   // not a new press
+      row = bankRow[c];
+      if (!midi_speculative(row[i].midiMessage)) continue;
+
+      DPRINTLNF("");
+      DPRINTF("Pedal ");
+      if (i < 9) DPRINTF(" ");
+      DPRINT(i + 1);
+      DPRINTF("   SPECULATIVE SINGLE PRESS ");
+
+      if (send) midi_send(row[i].midiMessage, row[i].midiCode, row[i].midiValue1, row[i].midiChannel);
+      pressSpeculated[i] |= (1 << c);
+      lastUsedSwitch = i;
+    }
+  }
+
+  pedalStates[i].pedalValue[0] = bitRead(state, CONTACT_TIP(i));
+  pedalStates[i].pedalValue[1] = bitRead(state, CONTACT_RING(i));
+
+  k1 = MD_UISwitch::KEY_NULL;
+  k2 = MD_UISwitch::KEY_NULL;
+  if (pool_switch(i, 0) != nullptr) k1 = pool_switch(i, 0)->read();
+  if (pool_switch(i, 1) != nullptr) k2 = pool_switch(i, 1)->read();
+
+  int j = 2;
+  while ( j >= 0) {
+    row = bankRow[j];
+    switch (j) {
+      case 0: k = k1; break;
+      case 1: k = k2; break;
+      case 2: k = (k1 == k2) ? k1 : MD_UISwitch::KEY_NULL; break;
+    }
+    switch (k) {
+
+      case MD_UISwitch::KEY_PRESS:
+
+        DPRINTLNF("");
+        DPRINTF("Pedal ");
+        if (i < 9) DPRINTF(" ");
+        DPRINT(i + 1);
+        DPRINTF("   SINGLE PRESS ");
+
+        if (send && (j == 2 || !(pressSpeculated[i] & (1 << j))))                  // not sent on press
+          midi_send(row[i].midiMessage, row[i].midiCode, row[i].midiValue1, row[i].midiChannel);
+        if (send) midi_send(row[i].midiMessage, row[i].midiCode, row[i].midiValue1, row[i].midiChannel, false);
+        lastUsedSwitch = i;
+        break;
+
+      case MD_UISwitch::KEY_DPRESS:
+
+        DPRINTLNF("");
+        DPRINTF("Pedal ");
+        if (i < 9) DPRINTF(" ");
+        DPRINT(i + 1);
+        DPRINTF("   DOUBLE PRESS ");
+
+        if (send) midi_send(row[i].midiMessage, row[i].midiCode, row[i].midiValue2, row[i].midiChannel);
+        if (send) midi_send(row[i].midiMessage, row[i].midiCode, row[i].midiValue2, row[i].midiChannel, false);
+        lastUsedSwitch = i;
+        break;
+
+      case MD_UISwitch::KEY_LONGPRESS:
+
+        DPRINTLNF("");
+        DPRINTF("Pedal ");
+        if (i < 9) DPRINTF(" ");
+        DPRINT(i + 1);
+        DPRINTF("   LONG   PRESS ");
+
+        if (send) midi_send(row[i].midiMessage, row[i].midiCode, row[i].midiValue3, row[i].midiChannel);
+        if (send) midi_send(row[i].midiMessage, row[i].midiCode, row[i].midiValue3, row[i].midiChannel, false);
+        lastUsedSwitch = i;
+        break;
+        
+      case MD_UISwitch::KEY_RPTPRESS:
+      case MD_UISwitch::KEY_NULL:
+        break;
+    }
+    if (k != MD_UISwitch::KEY_NULL) pressSpeculated[i] &= (j == 2) ? 0 : ~(1 << j);   // gesture resolved
+    if (k1 == k2 && k1 != MD_UISwitch::KEY_NULL) j = -1;
+    else j--;
+  }
+}
+
+//
+//  Analog pedals
+//
+void midi_refresh_analog(byte i, contacts_t state, bool send)
+{
+  unsigned int              input;
+  unsigned int              hires;
+  unsigned int              value;
+
+  if (pool_analog(i) == nullptr) return;                    // sanity check
+
+  hires = adc_read_hires(PIN_A(i));                         // last oversampled analog input value
+  input = hires >> ADC_OVERSAMPLING_BITS;                   // 10-bit value
+  if (pedals[i].autoSensing) calibration_track(i, hires);   // continuos calibration
+  hires = filter_update(*pool_analog(i), i, hires);         // adaptive smoothing of the raw input
+  value = map_analog(i, hires);                             // apply the digital map function to the value
+  if (pedals[i].invertPolarity) value = MIDI_RESOLUTION_14BIT - 1 - value;  // invert the scale
+  if (midi_is_14bit(bankRow[0][i].midiMessage)) {
+    if (!midi_ready_14bit()) return;                        // keep the latest value until DIN is ready
+  }
+  else
+    value = value >> 7;                                     // map from 14-bit value [0, 16383] to the 7-bit MIDI value [0, 127]
+  if (value != (unsigned int)pedalStates[i].pedalValue[0])  // if the value changed since last time
+  {
+    LATENCY_STAMP(LATENCY_MAPPED);
+#ifdef DEBUG_PEDALINO
+    double velocity = ((double)value - pedalStates[i].pedalValue[0]) / max(pedal_elapsed(i), 1);
+#endif
+
+    DPRINTLNF("");
+    DPRINTF("Pedal ");
+    if (i < 9) DPRINTF(" ");
+    DPRINT(i + 1);
+    DPRINTF("   input ");
+    DPRINT(input);
+    DPRINTF(" output ");
+    DPRINT(value);
+    DPRINTF(" velocity ");
+    DPRINT(velocity);
+
+    midi_ports_coalesce(bankRow[0][i].midiMessage != PED_CONTROL_CHANGE_RELATIVE);  // a port behind only gets the latest value
+    if (midi_is_14bit(bankRow[0][i].midiMessage)) {
+      if (send) midi_send_14bit(bankRow[0][i].midiMessage, bankRow[0][i].midiCode, value, bankRow[0][i].midiChannel);
+    }
+    else {
+      if (send) midi_send(bankRow[0][i].midiMessage, bankRow[0][i].midiCode, value, bankRow[0][i].midiChannel);
+      if (send && bankRow[0][i].midiMessage == PED_NOTE_ON_OFF)   // the release of the note, nothing to release otherwise
+        midi_send(bankRow[0][i].midiMessage, bankRow[0][i].midiCode, value, bankRow[0][i].midiChannel, false);
+    }
+    midi_ports_coalesce(false);
+    pedalStates[i].pedalValue[0] = value;
+    pedal_touch(i, millis());
+    lastUsedPedal = i;
+  }
+}
+
+//
+//  Resistor ladders
+//
+//  Button k sends the message of the pedal with code + k: Value 1 when pressed and Value 2
+//  when released, as a momentary switch. Two buttons held together are two buttons pressed.
+//
+void midi_refresh_ladder(byte i, contacts_t state, bool send)
+{
+  byte                      d = ladder_decoder_of(i);
+  unsigned int              held;
+  unsigned int              changed;
+  byte                      code;
+
+  if (d == LADDER_NONE) return;                             // sanity check
+
+  held = ladderDecoders[d].keys;
+  if (!ladder_read(d, PIN_A(i))) return;
+  changed = held ^ ladderDecoders[d].keys;
+  for (byte k = 0; k < LADDER_KEYS; k++) {
+    if (!(changed & (1U << k))) continue;
+    held = ladderDecoders[d].keys & (1U << k);
+    code = (bankRow[0][i].midiCode + k) & 0x7F;
+
+    DPRINTLNF("");
+    DPRINTF("Pedal ");
+    if (i < 9) DPRINTF(" ");
+    DPRINT(i + 1);
+    DPRINTF("   button ");
+    DPRINT(k + 1);
+    if (held) DPRINTF(" pressed");
+    else DPRINTF(" released");
+
+    if (held) {
+      if (send) midi_send(bankRow[0][i].midiMessage,
+                          code,
+                          bankRow[0][i].midiValue1,
+                          bankRow[0][i].midiChannel);
+    }
+    else
+      if (send) midi_send(bankRow[0][i].midiMessage,
+                          code,
+                          bankRow[0][i].midiValue2,
+                          bankRow[0][i].midiChannel,
+                          false);
+  }
+  pedal_touch(i, millis());
+  lastUsedSwitch = i;
+}
+
+//
+//  Jog wheels
+//
+//  Control Code Relative sends 64 +/- the accelerated steps of each movement (binary offset).
+//  Any other message follows an absolute value kept in pedalValue[0]: 7-bit messages move by
+//  one for each accelerated step, 14-bit messages by JOG_14BIT_STEP. pedalValue[1] is the last
+//  value sent, so a 14-bit value delayed by the DIN rate adaptation is sent as soon as possible.
+//
+void midi_refresh_jog(byte i, contacts_t state, bool send)
+{
+  byte                      message = bankRow[0][i].midiMessage;
+  byte                      code    = bankRow[0][i].midiCode;
+  byte                      channel = bankRow[0][i].midiChannel;
+  int                       full    = midi_is_14bit(message) ? MIDI_RESOLUTION_14BIT - 1 : MIDI_RESOLUTION - 1;
+  int                       detents;
+  int                       step;
+  int                       value;
+
+  detents = jog_read(i);
+  if (detents != 0) {
+    if (pedals[i].invertPolarity) detents = -detents;
+    step = detents * jog_acceleration(pedal_elapsed(i), detents);
+
+    DPRINTLNF("");
+    DPRINTF("Pedal ");
+    if (i < 9) DPRINTF(" ");
+    DPRINT(i + 1);
+    DPRINTF("   detents ");
+    DPRINT(detents);
+    DPRINTF(" step ");
+    DPRINT(step);
+
+    if (message == PED_CONTROL_CHANGE_RELATIVE) {
+      step = constrain(step, -63, 63);
+      if (send) midi_send(message, code, 64 + step, channel);
+    }
+    if (midi_is_14bit(message)) step *= JOG_14BIT_STEP;
+    pedalStates[i].pedalValue[0] = constrain(pedalStates[i].pedalValue[0] + step, 0, full);
+    pedal_touch(i, millis());
+    lastUsedPedal = i;
+  }
+
+  if (message == PED_CONTROL_CHANGE_RELATIVE) return;
+  if (pedalStates[i].pedalValue[0] == pedalStates[i].pedalValue[1]) return;       // already sent
+  value = min(pedalStates[i].pedalValue[0], full);                                // message changed by a bank switch
+  if (midi_is_14bit(message)) {
+    if (!midi_ready_14bit()) return;                                              // keep the latest value until DIN is ready
+    if (send) midi_send_14bit(message, code, value, channel);
+  }
+  else if (message == PED_PROGRAM_CHANGE) {
+    if (send) midi_send(message, value, 0, channel);                              // scroll programs
+  }
+  else {
+    if (send) midi_send(message, code, value, channel);
+    if (send) midi_send(message, code, value, channel, false);
+  }
+  pedalStates[i].pedalValue[1] = pedalStates[i].pedalValue[0];
+}
+
+//
+//  Build the pedal handler tables
+//
+void pedal_handlers_setup()
+{
+  contacts_t  momentary = 0;                  // tips of the single press momentary switches
+  contacts_t  invert    = 0;
+
+  switchTableCount = 0;
+  switchContacts   = 0;
+  pollTableCount   = 0;
+  memset(pressSpeculated, 0, sizeof(pressSpeculated));
 
   for (byte i = 0; i < PEDALS; i++) {
-    if (pedals[i].function == PED_MIDI) {
-      switch (pedals[i].mode) {
-
-        case PED_MOMENTARY1:
-        case PED_MOMENTARY2:
-        case PED_MOMENTARY3:
-        case PED_LATCH1:
-        case PED_LATCH2:
-
-          switch (pedals[i].pressMode) {
-
-            case PED_PRESS_1:
-              state1 = false;
-              state2 = false;
-              if (pedals[i].debouncer[0] != nullptr) state1 = pedals[i].debouncer[0]->update();
-              if (pedals[i].debouncer[1] != nullptr) state2 = pedals[i].debouncer[1]->update();
-              if (state1 && state2) {                                                     // pin state changed
-                input = pedals[i].debouncer[0]->read();                                   // reads the updated pin state
-                if (pedals[i].invertPolarity) input = (input == LOW) ? HIGH : LOW;        // invert the value
-                value = map_digital(i, input);                                            // apply the digital map function to the value
-
-                DPRINTLNF("");
-                DPRINTF("Pedal ");
-                if (i < 9) DPRINTF(" ");
-                DPRINT(i + 1);
-                DPRINTF("   input ");
-                DPRINT(input);
-                DPRINTF(" output ");
-                DPRINT(value);
-
-                b = (currentBank + 2) % BANKS;
-                if (value == LOW)                                                         // LOW = pressed, HIGH = released
-                  midi_send(banks[b][i].midiMessage,
-                            banks[b][i].midiCode,
-                            banks[b][i].midiValue1,
-                            banks[b][i].midiChannel);
-                else
-                  midi_send(banks[b][i].midiMessage,
-                            banks[b][i].midiCode,
-                            banks[b][i].midiValue2,
-                            banks[b][i].midiChannel,
-                            pedals[i].mode == PED_LATCH1 || pedals[i].mode == PED_LATCH2);
-                pedals[i].pedalValue[0] = value;
-                pedals[i].lastUpdate[0] = millis();
-                pedals[i].pedalValue[1] = pedals[i].pedalValue[0];
-                pedals[i].lastUpdate[1] = pedals[i].lastUpdate[0];
-                lastUsedSwitch = i;
-              }
-              else {
-                if (state1) {                                                             // pin state changed
-                  input = pedals[i].debouncer[0]->read();                                 // reads the updated pin state
-                  if (pedals[i].invertPolarity) input = (input == LOW) ? HIGH : LOW;      // invert the value
-                  value = map_digital(i, input);                                          // apply the digital map function to the value
-
-                  DPRINTLNF("");
-                  DPRINTF("Pedal ");
-                  if (i < 9) DPRINTF(" ");
-                  DPRINT(i + 1);
-                  DPRINTF("   input ");
-                  DPRINT(input);
-                  DPRINTF(" output ");
-                  DPRINT(value);
-
-                  b = currentBank;
-                  if (value == LOW) {                                                     // LOW = pressed, HIGH = released
-                    if (send) midi_send(banks[b][i].midiMessage,
-                                        banks[b][i].midiCode,
-                                        banks[b][i].midiValue1,
-                                        banks[b][i].midiChannel);
-                  }
-                  else
-                    if (send) midi_send(banks[b][i].midiMessage,
-                                        banks[b][i].midiCode,
-                                        banks[b][i].midiValue2,
-                                        banks[b][i].midiChannel,
-                                        pedals[i].mode == PED_LATCH1 || pedals[i].mode == PED_LATCH2);
-                  pedals[i].pedalValue[0] = value;
-                  pedals[i].lastUpdate[0] = millis();
-                  lastUsedSwitch = i;
-                }
-                if (state2) {                                                             // pin state changed
-                  input = pedals[i].debouncer[1]->read();                                 // reads the updated pin state
-                  if (pedals[i].invertPolarity) input = (input == LOW) ? HIGH : LOW;      // invert the value
-                  value = map_digital(i, input);                                          // apply the digital map function to the value
-
-                  DPRINTLNF("");
-                  DPRINTF("Pedal ");
-                  if (i < 9) DPRINTF(" ");
-                  DPRINT(i + 1);
-                  DPRINTF("   input ");
-                  DPRINT(input);
-                  DPRINTF(" output ");
-                  DPRINT(value);
-
-                  b = (currentBank + 1) % BANKS;
-                  if (value == LOW) {                                                      // LOW = pressed, HIGH = released
-                    if (send) midi_send(banks[b][i].midiMessage,
-                                        banks[b][i].midiCode,
-                                        banks[b][i].midiValue1,
-                                        banks[b][i].midiChannel);
-                  }
-                  else
-                    if (send) midi_send(banks[b][i].midiMessage,
-                                        banks[b][i].midiCode,
-                                        banks[b][i].midiValue2,
-                                        banks[b][i].midiChannel,
-                                        pedals[i].mode == PED_LATCH1 || pedals[i].mode == PED_LATCH2);
-                  pedals[i].pedalValue[1] = value;
-                  pedals[i].lastUpdate[1] = millis();
-                  lastUsedSwitch = i;
-                }
-              }
-              break;
+    if (pedals[i].function != PED_MIDI) continue;
+    switch (pedals[i].mode) {
 
-            case PED_PRESS_1_2:
-            case PED_PRESS_1_L:
-            case PED_PRESS_1_2_L:
-            case PED_PRESS_2:
-            case PED_PRESS_2_L:
-            case PED_PRESS_L:
-
-              if (pedals[i].mode == PED_LATCH1 || pedals[i].mode == PED_LATCH2) break;
-
-              pedals[i].pedalValue[0] = digitalRead(PIN_D(i));
-              //pedals[i].lastUpdate[0] = millis();
-              pedals[i].pedalValue[1] = digitalRead(PIN_A(i));
-              //pedals[i].lastUpdate[1] = millis();
-
-              k1 = MD_UISwitch::KEY_NULL;
-              k2 = MD_UISwitch::KEY_NULL;
-              if (pedals[i].footSwitch[0] != nullptr) k1 = pedals[i].footSwitch[0]->read();
-              if (pedals[i].footSwitch[1] != nullptr) k2 = pedals[i].footSwitch[1]->read();
-
-              int j = 2;
-              while ( j >= 0) {
-                b = (currentBank + j) % BANKS;
-                switch (j) {
-                  case 0: k = k1; break;
-                  case 1: k = k2; break;
-                  case 2: k = (k1 == k2) ? k1 : MD_UISwitch::KEY_NULL; break;
-                }
-                switch (k) {
-
-                  case MD_UISwitch::KEY_PRESS:
-
-                    DPRINTLNF("");
-                    DPRINTF("Pedal ");
-                    if (i < 9) DPRINTF(" ");
-                    DPRINT(i + 1);
-                    DPRINTF("   SINGLE PRESS ");
-
-                    if (send) midi_send(banks[b][i].midiMessage, banks[b][i].midiCode, banks[b][i].midiValue1, banks[b][i].midiChannel);
-                    if (send) midi_send(banks[b][i].midiMessage, banks[b][i].midiCode, banks[b][i].midiValue1, banks[b][i].midiChannel, false);
-                    lastUsedSwitch = i;
-                    break;
-
-                  case MD_UISwitch::KEY_DPRESS:
-
-                    DPRINTLNF("");
-                    DPRINTF("Pedal ");
-                    if (i < 9) DPRINTF(" ");
-                    DPRINT(i + 1);
-                    DPRINTF("   DOUBLE PRESS ");
-
-                    if (send) midi_send(banks[b][i].midiMessage, banks[b][i].midiCode, banks[b][i].midiValue2, banks[b][i].midiChannel);
-                    if (send) midi_send(banks[b][i].midiMessage, banks[b][i].midiCode, banks[b][i].midiValue2, banks[b][i].midiChannel, false);
-                    lastUsedSwitch = i;
-                    break;
-
-                  case MD_UISwitch::KEY_LONGPRESS:
-
-                    DPRINTLNF("");
-                    DPRINTF("Pedal ");
-                    if (i < 9) DPRINTF(" ");
-                    DPRINT(i + 1);
-                    DPRINTF("   LONG   PRESS ");
-
-                    if (send) midi_send(banks[b][i].midiMessage, banks[b][i].midiCode, banks[b][i].midiValue3, banks[b][i].midiChannel);
-                    if (send) midi_send(banks[b][i].midiMessage, banks[b][i].midiCode, banks[b][i].midiValue3, banks[b][i].midiChannel, false);
-                    lastUsedSwitch = i;
-                    break;
-                    
-                  case MD_UISwitch::KEY_RPTPRESS:
-                  case MD_UISwitch::KEY_NULL:
-                    break;
-                }
-                if (k1 == k2 && k1 != MD_UISwitch::KEY_NULL) j = -1;
-                else j--;
-              }
-              break;
-          }
-          break;
+      case PED_MOMENTARY1:
+      case PED_MOMENTARY2:
+      case PED_MOMENTARY3:
+      case PED_LATCH1:
+      case PED_LATCH2:
+        if (pedals[i].pressMode == PED_PRESS_1) {
+          switchTable[switchTableCount].pedal    = i;
+          switchTable[switchTableCount].contacts = CONTACT_BIT(CONTACT_TIP(i)) | CONTACT_BIT(CONTACT_RING(i));
+          switchTable[switchTableCount].invert   = pedals[i].invertPolarity ? 1 : 0;
+          switchTable[switchTableCount].latch    = (pedals[i].mode == PED_LATCH1 || pedals[i].mode == PED_LATCH2);
+          switchContacts |= switchTable[switchTableCount].contacts;
+          switchTableCount++;
+          if (!switchTable[switchTableCount - 1].latch) momentary |= CONTACT_BIT(CONTACT_TIP(i));
+          if (pedals[i].invertPolarity) invert |= CONTACT_BIT(CONTACT_TIP(i));
+        }
+        else if (pedals[i].mode != PED_LATCH1 && pedals[i].mode != PED_LATCH2) {
+          pollTable[pollTableCount].handler = midi_refresh_press;
+          pollTable[pollTableCount].pedal   = i;
+          pollTableCount++;
+        }
+        break;
 
-        case PED_ANALOG:
+      case PED_ANALOG:
+        if (pool_analog(i) == nullptr) break;
+        pollTable[pollTableCount].handler = midi_refresh_analog;
+        pollTable[pollTableCount].pedal   = i;
+        pollTableCount++;
+        break;
 
-          if (pedals[i].analogPedal == nullptr) continue;           // sanity check
+      case PED_LADDER:
+        if (ladder_decoder_of(i) == LADDER_NONE) break;
+        pollTable[pollTableCount].handler = midi_refresh_ladder;
+        pollTable[pollTableCount].pedal   = i;
+        pollTableCount++;
+        break;
 
-          input = analogRead(PIN_A(i));                             // read the raw analog input value
-          if (pedals[i].autoSensing) {                              // continuos calibration
+      case PED_JOG_WHEEL:
+        pollTable[pollTableCount].handler = midi_refresh_jog;
+        pollTable[pollTableCount].pedal   = i;
+        pollTableCount++;
+        break;
+    }
+  }
+  chord_setup(momentary, invert);
+  macro_setup();
+}
 
-            if (pedals[i].expZero > round(1.1 * input)) {
-              DPRINTF("Pedal ");
-              if (i < 9) DPRINTF(" ");
-              DPRINT(i + 1);
-              DPRINTF(" calibration min ");
-              DPRINT(round(1.1 * input));
-              DPRINTLNF("");
-            }
-            if (pedals[i].expMax < round(0.9 * input)) {
-              DPRINTF("Pedal ");
-              if (i < 9) DPRINTF(" ");
-              DPRINT(i + 1);
-              DPRINTF(" calibration max ");
-              DPRINT(round(0.9 * input));
-              DPRINTLNF("");
-            }
+//
+//  Single press switches changed by a scanner event
+//
+void midi_refresh_switches(const pedal_event &e, bool send)
+{
+  for (byte s = 0; s < switchTableCount; s++)
+    if (e.changed & switchTable[s].contacts) {
+      LATENCY_BEGIN(switchTable[s].pedal, e);
+      midi_edge_begin(e.edge);
+      midi_refresh_switch(switchTable[s], e, send);
+      midi_edge_end();
+      LATENCY_END();
+    }
+}
 
-            pedals[i].expZero = min(pedals[i].expZero, round(1.1 * input));
-            pedals[i].expMax  = max(pedals[i].expMax,  round(0.9 * input));
-          }
-          value = map_analog(i, input);                             // apply the digital map function to the value
-          if (pedals[i].invertPolarity) value = ADC_RESOLUTION - 1 - value;   // invert the scale
-          value = value >> 3;                                       // map from 10-bit value [0, 1023] to the 7-bit MIDI value [0, 127]
-          pedals[i].analogPedal->update(value);                     // update the responsive analog average
-          if (pedals[i].analogPedal->hasChanged())                  // if the value changed since last time
-          {
-            value = pedals[i].analogPedal->getValue();              // get the responsive analog average value
-            double velocity = ((double)value - pedals[i].pedalValue[0]) / (millis() - pedals[i].lastUpdate[0]);
-
-            DPRINTLNF("");
-            DPRINTF("Pedal ");
-            if (i < 9) DPRINTF(" ");
-            DPRINT(i + 1);
-            DPRINTF("   input ");
-            DPRINT(input);
-            DPRINTF(" output ");
-            DPRINT(value);
-            DPRINTF(" velocity ");
-            DPRINT(velocity);
-
-            if (send) midi_send(banks[currentBank][i].midiMessage, banks[currentBank][i].midiCode, value, banks[currentBank][i].midiChannel);
-            if (send) midi_send(banks[currentBank][i].midiMessage, banks[currentBank][i].midiCode, value, banks[currentBank][i].midiChannel, false);
-            pedals[i].pedalValue[0] = value;
-            pedals[i].lastUpdate[0] = millis();
-            lastUsedPedal = i;
-          }
-          break;
-      }
+//
+//  Send the chord messages, note off of the note on messages when released
+//
+void midi_chord_send(byte c, unsigned long edge, bool on_off, bool send)
+{
+  midi_edge_begin(edge);
+  for (byte m = 0; m < chords[c].messages; m++)
+    if (send) midi_send(chords[c].message[m].midiMessage,
+                        chords[c].message[m].midiCode,
+                        chords[c].message[m].midiValue,
+                        chords[c].message[m].midiChannel,
+                        on_off);
+  midi_edge_end();
+}
+
+//
+//  Close the chord window: send the chord matched or replay the changes held
+//
+void midi_chord_close(bool send)
+{
+  byte c = chordFound;
+
+  if (c < CHORDS) {
+    DPRINTLNF("");
+    DPRINTF("Chord ");
+    DPRINT(c + 1);
+    midi_chord_send(c, chordHeld[chordHeldCount - 1].edge, true, send);   // the change completing the chord
+    chordState = CHORD_MATCHED;
+    chordSent  = c;
+    if ((chord_pressed(scanner_state()) & chordMask[c]) != chordMask[c]) {
+      midi_chord_send(c, chordHeld[chordHeldCount - 1].edge, false, send);
+      chordSent = CHORDS;
     }
   }
+  else {
+    chordState = CHORD_PASS;
+    for (byte h = 0; h < chordHeldCount; h++)
+      midi_refresh_switches(chordHeld[h], send);
+  }
+  chordHeldCount = 0;
+  if (chord_pressed(scanner_state()) == 0) chordState = CHORD_IDLE;
+}
+
+//
+//  Route the chord contacts of a scanner event, the ones held or dropped are cleared from it
+//
+void midi_refresh_chord(pedal_event &e, bool send)
+{
+  contacts_t pressed = chord_pressed(e.state);
+
+  if (chordState == CHORD_HOLD && chordHeldCount == CHORD_HELD) midi_chord_close(send);
+
+  switch (chordState) {
+
+    case CHORD_IDLE:
+      if (pressed == 0) break;
+      chordState   = CHORD_HOLD;
+      chordStart   = e.time;
+      chordPressed = 0;
+      chordFound   = CHORDS;
+      // fall through
+
+    case CHORD_HOLD:
+      if (pressed & ~chordPressed) chordFound = chord_match(pressed);   // a new press, releases keep the chord
+      chordPressed = pressed;
+      chordHeld[chordHeldCount] = e;
+      chordHeld[chordHeldCount].changed &= chordContacts;
+      chordHeldCount++;
+      e.changed &= ~chordContacts;
+      break;
+
+    case CHORD_MATCHED:
+      e.changed &= ~chordContacts;
+      if (chordSent < CHORDS && (pressed & chordMask[chordSent]) != chordMask[chordSent]) {
+        midi_chord_send(chordSent, e.edge, false, send);
+        chordSent = CHORDS;
+      }
+      if (pressed == 0) chordState = CHORD_IDLE;
+      break;
+
+    case CHORD_PASS:
+      if (pressed == 0) chordState = CHORD_IDLE;
+      break;
+  }
+}
+
+//
+//  MIDI messages refresh
+//
+void midi_refresh(bool send = true)
+{
+  pedal_event               e;
+  contacts_t                state;
+
+  // Switch changes queued by the sampling interrupt, in the order they happened
+  while (scanner_pop(e)) {
+    e.changed &= ~autosensingContacts;                      // pedal out of service
+    if (e.changed & chordContacts)  midi_refresh_chord(e, send);
+    if (e.changed & switchContacts) midi_refresh_switches(e, send);
+  }
+  if (chordState == CHORD_HOLD && millis() - chordStart >= CHORD_WINDOW) midi_chord_close(send);
+
+  if (pollTableCount == 0) return;
+  state = scanner_state();
+  for (byte p = 0; p < pollTableCount; p++) {
+    if (pollTable[p].pedal == autosensingPedal) continue;  // out of service
+    LATENCY_POLL(pollTable[p].pedal);
+    pollTable[p].handler(pollTable[p].pedal, state, send);
+    LATENCY_END();
+  }
 }
 
 //
@@ -516,13 +1183,17 @@ void midi_refresh(bool send = true)
 //
 void controller_setup()
 {
-  // Delete previous setup
+  // Delete previous setup and cancel the probe in progress
+  autosensingState    = AUTOSENSING_IDLE;
+  autosensingPedal    = 0xFF;
+  autosensingContacts = 0;
+  scanner_reset();
+  jog_reset();
+  ladder_reset();
+  adc_reset();
   for (byte i = 0; i < PEDALS; i++) {
-    //delete pedals[i].debouncer[0];
-    //delete pedals[i].debouncer[1];
-    //delete pedals[i].footSwitch[0];
-    //delete pedals[i].footSwitch[1];
-    delete pedals[i].analogPedal;
+    pool_release(i);
+    scanner_bounce(i, pedals[i].bounceTime);
   }
 
   lastUsedSwitch = 0xFF;
@@ -612,6 +1283,17 @@ void controller_setup()
       case PED_PITCH_BEND:
         DPRINTF("PITCH_BEND     ");
         break;
+      case PED_CONTROL_CHANGE_14BIT:
+        DPRINTF("CONTROL_CHANGE_14BIT ");
+        DPRINT(banks[currentBank][i].midiCode);
+        break;
+      case PED_PITCH_BEND_14BIT:
+        DPRINTF("PITCH_BEND_14BIT     ");
+        break;
+      case PED_CONTROL_CHANGE_RELATIVE:
+        DPRINTF("CONTROL_CHANGE_RELATIVE ");
+        DPRINT(banks[currentBank][i].midiCode);
+        break;
     }
     DPRINTF("   Channel ");
     DPRINT(banks[currentBank][i].midiChannel);
@@ -630,14 +1312,13 @@ void controller_setup()
           if (pedals[i].mode == PED_MOMENTARY1 && p == 1) continue;
           if (pedals[i].mode == PED_LATCH1     && p == 1) continue;
 
-          pedals[i].debouncer[p] = new Bounce();
           switch (p) {
             case 0:
               // Setup the button with an internal pull-up
               pinMode(PIN_D(i), INPUT_PULLUP);
 
-              // After setting up the button, setup the Bounce instance
-              pedals[i].debouncer[0]->attach(PIN_D(i));
+              // After setting up the button, attach it to the scanner
+              scanner_attach(CONTACT_TIP(i), PIN_D(i), pedals[i].invertPolarity);
               DPRINTF("   Pin D");
               DPRINT(PIN_D(i));
               break;
@@ -645,64 +1326,62 @@ void controller_setup()
               // Setup the button with an internal pull-up
               pinMode(PIN_A(i), INPUT_PULLUP);
 
-              // After setting up the button, setup the Bounce instance
-              pedals[i].debouncer[1]->attach(PIN_A(i));
+              // After setting up the button, attach it to the scanner
+              scanner_attach(CONTACT_RING(i), PIN_A(i), pedals[i].invertPolarity);
               DPRINTF(" A");
               DPRINT(i);
               break;
           }
-          pedals[i].debouncer[p]->interval(DEBOUNCE_INTERVAL);
-          pedals[i].debouncer[p]->update();
-          input = pedals[i].debouncer[p]->read();                                 // reads the updated pin state
+          input = bitRead(scanState, CONTACT_TIP(i) + p);                         // reads the updated pin state
           if (pedals[i].invertPolarity) input = (input == LOW) ? HIGH : LOW;      // invert the value
           value = map_digital(i, input);                                          // apply the digital map function to the value
-          pedals[i].pedalValue[p] = value;
-          pedals[i].lastUpdate[p] = millis();
+          pedalStates[i].pedalValue[p] = value;
+          pedal_touch(i, millis());
 
           if (pedals[i].mode == PED_MOMENTARY1 || pedals[i].mode == PED_MOMENTARY2 || pedals[i].mode == PED_MOMENTARY3)
           {
             switch (p) {
               case 0:
-                pedals[i].footSwitch[0] = new MD_UISwitch_Digital(PIN_D(i), pedals[i].invertPolarity ? HIGH : LOW);
+                pool_new_digital(i, 0, PIN_D(i), pedals[i].invertPolarity ? HIGH : LOW);
                 break;
               case 1:
-                pedals[i].footSwitch[1] = new MD_UISwitch_Digital(PIN_A(i), pedals[i].invertPolarity ? HIGH : LOW);
+                pool_new_digital(i, 1, PIN_A(i), pedals[i].invertPolarity ? HIGH : LOW);
                 break;
             }
-            pedals[i].footSwitch[p]->begin();
-            pedals[i].footSwitch[p]->setDebounceTime(DEBOUNCE_INTERVAL);
+            pool_switch(i, p)->begin();
+            pool_switch(i, p)->setDebounceTime(scanLimit[CONTACT_TIP(i)]);
             if (pedals[i].function == PED_MIDI) {
               switch (pedals[i].pressMode) {
                 case PED_PRESS_1:
-                  pedals[i].footSwitch[p]->enableDoublePress(false);
-                  pedals[i].footSwitch[p]->enableLongPress(false);
+                  pool_switch(i, p)->enableDoublePress(false);
+                  pool_switch(i, p)->enableLongPress(false);
                   break;
                 case PED_PRESS_2:
                 case PED_PRESS_1_2:
-                  pedals[i].footSwitch[p]->enableDoublePress(true);
-                  pedals[i].footSwitch[p]->enableLongPress(false);
+                  pool_switch(i, p)->enableDoublePress(true);
+                  pool_switch(i, p)->enableLongPress(false);
                   break;
                 case PED_PRESS_L:
                 case PED_PRESS_1_L:
-                  pedals[i].footSwitch[p]->enableDoublePress(false);
-                  pedals[i].footSwitch[p]->enableLongPress(true);
+                  pool_switch(i, p)->enableDoublePress(false);
+                  pool_switch(i, p)->enableLongPress(true);
                   break;
                 case PED_PRESS_1_2_L:
                 case PED_PRESS_2_L:
-                  pedals[i].footSwitch[p]->enableDoublePress(true);
-                  pedals[i].footSwitch[p]->enableLongPress(true);
+                  pool_switch(i, p)->enableDoublePress(true);
+                  pool_switch(i, p)->enableLongPress(true);
                   break;
               }
-              pedals[i].footSwitch[p]->setDoublePressTime(300);
-              pedals[i].footSwitch[p]->setLongPressTime(500);
-              pedals[i].footSwitch[p]->enableRepeat(false);
+              pool_switch(i, p)->setDoublePressTime(300);
+              pool_switch(i, p)->setLongPressTime(500);
+              pool_switch(i, p)->enableRepeat(false);
             }
             else
             {
-              pedals[i].footSwitch[p]->setDoublePressTime(300);
-              pedals[i].footSwitch[p]->setLongPressTime(500);
-              pedals[i].footSwitch[p]->setRepeatTime(500);
-              pedals[i].footSwitch[p]->enableRepeatResult(true);
+              pool_switch(i, p)->setDoublePressTime(300);
+              pool_switch(i, p)->setLongPressTime(500);
+              pool_switch(i, p)->setRepeatTime(500);
+              pool_switch(i, p)->enableRepeatResult(true);
             }
           }
         }
@@ -711,65 +1390,48 @@ void controller_setup()
       case PED_ANALOG:
         pinMode(PIN_D(i), OUTPUT);
         digitalWrite(PIN_D(i), HIGH);
+        adc_attach(PIN_A(i));
         if (pedals[i].function == PED_MIDI) {
-          pedals[i].analogPedal = new ResponsiveAnalogRead(PIN_A(i), true);
-          pedals[i].analogPedal->setActivityThreshold(6.0);
-          pedals[i].analogPedal->setAnalogResolution(MIDI_RESOLUTION);        // 7-bit MIDI resolution
-          pedals[i].analogPedal->enableEdgeSnap();                            // ensures that values at the edges of the spectrum can be easily reached when sleep is enabled
+          pool_new_analog(i);                                                 // primed by its first input
           if (lastUsedPedal == 0xFF) lastUsedPedal = i;
         }
         break;
 
       case PED_LADDER:
-        pedals[i].footSwitch[0] = new MD_UISwitch_Analog(PIN_A(i), kt, ARRAY_SIZE(kt));
+
+        byte decoder;
+        adc_attach(PIN_A(i));
         DPRINTF("   Pin A");
         DPRINT(i);
-        pedals[i].footSwitch[0]->begin();
-        pedals[i].footSwitch[0]->setDebounceTime(DEBOUNCE_INTERVAL);
-        if (pedals[i].function == PED_MIDI) {
-          switch (pedals[i].pressMode) {
-            case PED_PRESS_1:
-              pedals[i].footSwitch[0]->enableDoublePress(false);
-              pedals[i].footSwitch[0]->enableLongPress(false);
-              break;
-            case PED_PRESS_2:
-            case PED_PRESS_1_2:
-              pedals[i].footSwitch[0]->enableDoublePress(true);
-              pedals[i].footSwitch[0]->enableLongPress(false);
-              break;
-            case PED_PRESS_L:
-            case PED_PRESS_1_L:
-              pedals[i].footSwitch[0]->enableDoublePress(false);
-              pedals[i].footSwitch[0]->enableLongPress(true);
-              break;
-            case PED_PRESS_1_2_L:
-            case PED_PRESS_2_L:
-              pedals[i].footSwitch[0]->enableDoublePress(true);
-              pedals[i].footSwitch[0]->enableLongPress(true);
-              break;
-          }
-          pedals[i].footSwitch[0]->setDoublePressTime(300);
-          pedals[i].footSwitch[0]->setLongPressTime(500);
-          pedals[i].footSwitch[0]->enableRepeat(false);
-        }
-        else
-        {
-          /*
-          pedals[i].footSwitch[0]->setDoublePressTime(300);
-          pedals[i].footSwitch[0]->setLongPressTime(500);
-          pedals[i].footSwitch[0]->setRepeatTime(500);
-          pedals[i].footSwitch[0]->enableRepeatResult(true);
-          */
-          pedals[i].footSwitch[0]->enableDoublePress(false);
-          pedals[i].footSwitch[0]->enableLongPress(false);
-        }
+        decoder = ladder_setup(i);
+        if (pedals[i].function == PED_MIDI) break;                              // decoded by midi_refresh_ladder()
+        pool_new_ladder(i, PIN_A(i), decoder);
+        pool_switch(i, 0)->begin();
+        pool_switch(i, 0)->setDebounceTime(DEBOUNCE_INTERVAL);
+        pool_switch(i, 0)->enableDoublePress(false);
+        pool_switch(i, 0)->enableLongPress(false);
         break;
 
       case PED_JOG_WHEEL:
+        pinMode(PIN_D(i), INPUT_PULLUP);
+        pinMode(PIN_A(i), INPUT_PULLUP);
+        jog_attach(i, PIN_D(i), PIN_A(i));
+        DPRINTF("   Pin D");
+        DPRINT(PIN_D(i));
+        DPRINTF(" A");
+        DPRINT(i);
+        // Start from the center, nothing is sent until the wheel moves
+        pedalStates[i].pedalValue[0] = (midi_is_14bit(banks[currentBank][i].midiMessage) ? MIDI_RESOLUTION_14BIT : MIDI_RESOLUTION) / 2;
+        pedalStates[i].pedalValue[1] = pedalStates[i].pedalValue[0];
+        pedal_touch(i, millis());
         break;
     }
     DPRINTLNF("");
   }
+  pool_report();
+  pedal_handlers_setup();
+  scanner_start();
+  adc_start();
   for (byte i = 0; i < 100; i++)
     midi_refresh(false);            // to avoid spurious readings
 }
@@ -779,6 +1441,7 @@ void controller_setup()
 //
 #ifdef NOLCD
 #define calibrate(...)
+#define calibrate_ladder(...)
 #else
 void calibrate()
 {
@@ -799,7 +1462,7 @@ void calibrate()
   while (millis() - start < CALIBRATION_DURATION) {
 
     // Read the current value and update min and max
-    int ax = analogRead(PIN_A(currentPedal));
+    int ax = adc_read(PIN_A(currentPedal));
     pedals[currentPedal].expZero = min( pedals[currentPedal].expZero, ax + 20);
     pedals[currentPedal].expMax  = max( pedals[currentPedal].expMax, ax - 20);
 
@@ -815,6 +1478,90 @@ void calibrate()
     lcd.print(pedals[currentPedal].expMax);
   }
 }
+
+//
+// Calibration for resistor ladders
+//
+// Each button is held for LADDER_LEARN_HOLD ms, in the order they will be numbered, until no
+// button is pressed for LADDER_LEARN_TIMEOUT ms. The tolerance of each button covers the noise
+// read while held, without reaching the band of another button. A button not released within
+// LADDER_LEARN_TIMEOUT ms aborts the calibration and keeps the previous layout.
+//
+void calibrate_ladder()
+{
+  byte          l;
+  ladder        learned = {LADDER_NONE, 0, {0}, {0}};
+  int           idle;
+  int           value;
+  int           low;
+  int           high;
+  unsigned long start;
+
+  // Layout of the pedal or a free one
+  for (l = 0; l < LADDERS && ladders[l].pedal != currentPedal; l++);
+  if (l == LADDERS)
+    for (l = 0; l < LADDERS && ladders[l].pedal != LADDER_NONE; l++);
+  if (l == LADDERS) return;
+
+  lcd.clear();
+  idle = adc_read(PIN_A(currentPedal));                     // no button held
+
+  while (learned.keys < LADDER_KEYS) {
+    lcd.setCursor(0, 0);
+    lcd.print(F("Hold button "));
+    lcd.print(learned.keys + 1);
+    lcd.print(F("   "));
+
+    // Wait for a button
+    start = millis();
+    do {
+      value = adc_read(PIN_A(currentPedal));
+    } while (abs(value - idle) <= LADDER_MIN_TOLERANCE && millis() - start < LADDER_LEARN_TIMEOUT);
+    if (abs(value - idle) <= LADDER_MIN_TOLERANCE) break;   // no more buttons
+
+    // Read it while held, after the contact bounce
+    delay(DEBOUNCE_INTERVAL);
+    low  = ADC_RESOLUTION - 1;
+    high = 0;
+    start = millis();
+    while (millis() - start < LADDER_LEARN_HOLD) {
+      value = adc_read(PIN_A(currentPedal));
+      low   = min(low,  value);
+      high  = max(high, value);
+    }
+    learned.threshold[learned.keys] = (low + high) / 2;
+    learned.tolerance[learned.keys] = min((high - low) / 2 + LADDER_MIN_TOLERANCE, 255);
+
+    lcd.setCursor(0, 1);
+    lcd.print(learned.threshold[learned.keys]);
+    lcd.print(F(" +/-"));
+    lcd.print(learned.tolerance[learned.keys]);
+    lcd.print(F("      "));
+
+    // Wait for the release
+    start = millis();
+    while (abs(adc_read(PIN_A(currentPedal)) - idle) > LADDER_MIN_TOLERANCE)
+      if (millis() - start >= LADDER_LEARN_TIMEOUT) {
+        lcd.setCursor(0, 1);
+        lcd.print(F("Not released    "));
+        delay(1000);
+        return;
+      }
+    delay(DEBOUNCE_INTERVAL);
+    learned.keys++;
+  }
+
+  // Bands must not overlap
+  for (byte a = 0; a < learned.keys; a++)
+    for (byte b = 0; b < learned.keys; b++) {
+      unsigned int gap = abs((int)learned.threshold[a] - (int)learned.threshold[b]);
+      if (a != b && learned.tolerance[a] >= gap / 2) learned.tolerance[a] = max(gap / 2, 1) - 1;
+    }
+
+  learned.pedal = (learned.keys > 0) ? currentPedal : LADDER_NONE;
+  ladders[l] = learned;
+  controller_setup();
+}
 #endif  // NOLCD
 
 //
@@ -822,9 +1569,7 @@ void calibrate()
 //
 void mtc_midi_send(byte b)
 {
-  if (interfaces[0].midiClock) Serial.write(b);                               // USB
-  if (interfaces[1].midiClock) Serial2.write(b);                              // DIN
-  if (interfaces[2].midiClock || interfaces[3].midiClock) Serial3.write(b);   // AppleMIDI - BLE
+  midi_ports_send(midiClockPorts, &b, 1);
 }
 
 //
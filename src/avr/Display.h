@@ -34,13 +34,13 @@ char foot_char(byte footswitch)
   if ((footswitch == lastUsedPedal) ||
 
       ((pedals[footswitch].mode == PED_MOMENTARY1 ||
-        pedals[footswitch].mode == PED_LATCH1) && pedals[footswitch].pedalValue[0] == LOW) ||
+        pedals[footswitch].mode == PED_LATCH1) && pedalStates[footswitch].pedalValue[0] == LOW) ||
 
       ((pedals[footswitch].mode == PED_MOMENTARY2 ||
         pedals[footswitch].mode == PED_MOMENTARY3 ||
-        pedals[footswitch].mode == PED_LATCH2) && pedals[footswitch].pedalValue[0] == LOW) ||
+        pedals[footswitch].mode == PED_LATCH2) && pedalStates[footswitch].pedalValue[0] == LOW) ||
         
-        pedals[footswitch].pedalValue[1] == LOW) return bar1[footswitch % 10];
+        pedalStates[footswitch].pedalValue[1] == LOW) return bar1[footswitch % 10];
   return ' ';
 }
 
@@ -53,6 +53,7 @@ void screen_update(bool force = false) {
   static byte batteryLevel = 0;
 
   byte        f, p;
+  int         level = 0;
 
   if (!powersaver) {
     
@@ -130,17 +131,19 @@ void screen_update(bool force = false) {
     memset(buf, 0, sizeof(buf));
     sprintf(&buf[strlen(buf)], "Bank%2d", currentBank + 1);
     if (lastUsedPedal >= 0 && lastUsedPedal < PEDALS) {
-      //strncpy(&buf[strlen(buf)], &bar2[0], map(pedals[lastUsedPedal].pedalValue[0], 0, MIDI_RESOLUTION - 1, 0, 10));
-      //strncpy(&buf[strlen(buf)], "          ", 10 - map(pedals[lastUsedPedal].pedalValue[0], 0, MIDI_RESOLUTION - 1, 0, 10));
-      f = map(pedals[lastUsedPedal].pedalValue[0], 0, MIDI_RESOLUTION - 1, 0, 50);
+      //strncpy(&buf[strlen(buf)], &bar2[0], map(pedalStates[lastUsedPedal].pedalValue[0], 0, MIDI_RESOLUTION - 1, 0, 10));
+      //strncpy(&buf[strlen(buf)], "          ", 10 - map(pedalStates[lastUsedPedal].pedalValue[0], 0, MIDI_RESOLUTION - 1, 0, 10));
+      level = pedalStates[lastUsedPedal].pedalValue[0];
+      if (midi_is_14bit(banks[currentBank][lastUsedPedal].midiMessage)) level = level >> 7;
+      f = map(level, 0, MIDI_RESOLUTION - 1, 0, 50);
       p = f % 5;
       f = f / 5;
       strncpy(&buf[strlen(buf)], &bar2[0], f);
     }
-    if (force || strcmp(screen2, buf) != 0 || analog != pedals[lastUsedPedal].pedalValue[0]) {     // do not update if not changed
+    if (force || strcmp(screen2, buf) != 0 || analog != level) {     // do not update if not changed
       memset(screen2, 0, sizeof(screen2));
       strncpy(screen2, buf, LCD_COLS);
-      analog = pedals[lastUsedPedal].pedalValue[0];
+      analog = level;
       lcd.setCursor(0, 1);
       lcd.print(buf);
       if (p > 0) lcd.write((byte)(p - 1));
@@ -0,0 +1,134 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Adaptive smoothing of analog pedals
+//
+//  A fixed-point 1-Euro filter (Casiez, Roussel, Vogel 2012) on the oversampled ADC value,
+//  before calibration and response curve. Each new set of the analog scanner moves an
+//  exponential average toward the input, with a cutoff frequency that rises with the speed
+//  of the pedal:
+//
+//    cutoff = filterCutoff + filterBeta * |speed|
+//
+//  so a pedal at rest is strongly smoothed and a pedal moving fast follows with little lag.
+//  The speed is averaged too, with the fixed FILTER_SPEED_CUTOFF. The smoothing factor of a
+//  cutoff fc over the time dt since the previous set is
+//
+//    alpha = 2 pi fc dt / (1 + 2 pi fc dt) = fc dt / (FILTER_TAU_SCALE + fc dt)
+//
+//  with fc in 0.1 Hz and dt in us, computed in Q12 with a single 32-bit division. The average
+//  keeps FILTER_FRACTION_BITS below the oversampled LSB and the output moves only when the
+//  average is FILTER_HYSTERESIS away from it, so the 14-bit value does not flicker.
+//
+//  Tuning of each pedal: filterCutoff is the cutoff at rest in 0.1 Hz, filterBeta adds 0.1 Hz
+//  for each full travel per second. Both are saved as one of the FILTER_TUNING_STEPS values of
+//  filterTuning[], 4 bits each in the pedal setup words. dt is measured with the low 16 bits of micros(): a set
+//  later than 65 ms is filtered as a faster one, a pedal is never left behind.
+//
+
+#define FILTER_FRACTION_BITS    8
+#define FILTER_ONE              4096                // 1.0 in Q12
+#define FILTER_TAU_SCALE        1591549UL           // 1e6 us * 10 / (2 pi)
+#define FILTER_SPEED_CUTOFF     10                  // 1 Hz
+#define FILTER_SPEED_MAX        (64L * ADC_HIRES_RESOLUTION)        // 64 full travels per second
+#define FILTER_CUTOFF_MAX       2000                // 200 Hz
+#define FILTER_HYSTERESIS       (3 << (FILTER_FRACTION_BITS - 1))   // 1.5 oversampled LSB
+#define FILTER_DEFAULT_CUTOFF   10                  // 1 Hz at rest
+#define FILTER_DEFAULT_BETA     40                  // +4 Hz per full travel per second
+
+#ifdef _SIMULATOR_H
+#define FILTER_PROBE(p, input, output)  sim_filter_probe(p, input, output)
+#else
+#define FILTER_PROBE(p, input, output)
+#endif
+
+struct filter {
+  long                   value;                 // average, oversampled << FILTER_FRACTION_BITS
+  long                   speed;                 // average speed, oversampled LSB per second
+  unsigned int           output;                // last output, oversampled
+  uint16_t               time;                  // micros() of the last set, low 16 bits
+  byte                   set;                   // last analog scanner set filtered
+  bool                   primed;                // value and output are valid
+};
+
+//
+//  Tuning step nearest to a value in 0.1 Hz
+//
+byte filter_tuning_step(unsigned int value)
+{
+  byte s = 0;
+
+  while (s < FILTER_TUNING_STEPS - 1 &&
+         value > (FILTER_TUNING(s) + (unsigned int)FILTER_TUNING(s + 1)) / 2) s++;
+  return s;
+}
+
+//
+//  Smoothing factor in Q12 of a cutoff (0.1 Hz) over dt (us)
+//
+unsigned int filter_alpha(unsigned int cutoff, uint16_t dt)
+{
+  unsigned long fcdt = (unsigned long)cutoff * dt;
+
+  return min(fcdt / ((FILTER_TAU_SCALE + fcdt) >> 12), (unsigned long)FILTER_ONE);
+}
+
+//
+//  Move an average toward a target, the difference must fit in 20 bits plus sign
+//
+long filter_step(long average, long target, unsigned int alpha)
+{
+  return average + (target - average) * (long)(alpha / 2) / (FILTER_ONE / 2);
+}
+
+//
+//  Filter an oversampled value of pedal p, returns the smoothed oversampled value
+//
+unsigned int filter_update(filter &f, byte p, unsigned int input)
+{
+  byte          set  = adc_set();
+  uint16_t      now  = micros();
+  uint16_t      dt;
+  long          target;
+  long          speed;
+  unsigned long cutoff;
+
+  if (f.primed && set == f.set) return f.output;          // same value of the previous call
+  f.set  = set;
+  dt     = max((uint16_t)(now - f.time), (uint16_t)4);
+  f.time = now;
+  target = (long)input << FILTER_FRACTION_BITS;
+
+  if (!f.primed) {
+    f.value  = target;
+    f.speed  = 0;
+    f.output = input;
+    f.primed = true;
+    FILTER_PROBE(p, input, f.output);
+    return f.output;
+  }
+
+  // Speed of the input from the average, in oversampled LSB per second
+  speed    = (target - f.value) * (1000000L >> (FILTER_FRACTION_BITS + 2)) / (dt >> 2);
+  speed    = constrain(speed, -FILTER_SPEED_MAX, FILTER_SPEED_MAX);
+  f.speed  = filter_step(f.speed, speed, filter_alpha(FILTER_SPEED_CUTOFF, dt));
+
+  // filterBeta is 0.1 Hz per full travel (ADC_HIRES_RESOLUTION) per second
+  cutoff   = FILTER_TUNING(pedals[p].filterCutoff) +
+             (unsigned long)FILTER_TUNING(pedals[p].filterBeta) * labs(f.speed) / ADC_HIRES_RESOLUTION;
+  cutoff   = constrain(cutoff, 1UL, (unsigned long)FILTER_CUTOFF_MAX);
+  f.value  = filter_step(f.value, target, filter_alpha(cutoff, dt));
+
+  if (labs(f.value - ((long)f.output << FILTER_FRACTION_BITS)) >= FILTER_HYSTERESIS)
+    f.output = (f.value + (1 << (FILTER_FRACTION_BITS - 1))) >> FILTER_FRACTION_BITS;
+  FILTER_PROBE(p, input, f.output);
+  return f.output;
+}
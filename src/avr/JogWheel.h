@@ -0,0 +1,160 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+//
+//  Quadrature jog wheels
+//
+//  A rotary encoder takes the place of the switches of a pedal: channel A on the tip (PIN_D)
+//  and channel B on the ring (PIN_A). The two channels are decoded with a transition table
+//  every time they are sampled, so contact bounce counts back and forth and cancels itself.
+//
+//  Decoding runs in interrupts, never in the main loop: at every tick of the switch scanner
+//  interrupt (1 ms) and, on the MEGA, at every pin change of the channels wired to PORTB
+//  (D50-D53) or PORTK (A8-A15). Most of the tip pins have no pin change interrupt, so the
+//  scanner tick is what guarantees decoding on every pedal; pin change interrupts only make it
+//  edge accurate where available. On the UNO the pin change vectors belong to SoftwareSerial.
+//  The vectors are shared with the edge timestamps of the switch scanner (see Scanner.h).
+//
+//  The interrupts only move a free running 8-bit position counter. The main loop reads the
+//  difference from its previous reading, so no lock is needed as long as less than 128 quarter
+//  steps happen between two readings.
+//
+
+#include <util/atomic.h>
+
+#define JOG_WHEELS            4                 // max number of jog wheels
+#define JOG_STEPS_PER_DETENT  4                 // quarter steps for each detent
+#define JOG_ACCEL_SLOW        60                // ms per detent below which steps are doubled
+#define JOG_ACCEL_MEDIUM      30                // ms per detent below which steps are x4
+#define JOG_ACCEL_FAST        15                // ms per detent below which steps are x8
+#define JOG_14BIT_STEP        32                // 14-bit units for each detent (512 detents end to end)
+
+struct jog_wheel {
+  volatile uint8_t      *portA;                 // PINx register of channel A
+  byte                   maskA;
+  volatile uint8_t      *portB;                 // PINx register of channel B
+  byte                   maskB;
+  byte                   pedal;
+  byte                   state;                 // last AB level (interrupt only)
+  volatile int8_t        position;              // quarter steps, free running (interrupt only)
+  int8_t                 last;                  // position at the previous reading (main loop only)
+  int8_t                 rest;                  // quarter steps not yet a full detent (main loop only)
+};
+
+// Quarter step for each (previous AB << 2 | current AB), 0 on no change or on invalid transitions
+const int8_t jogTransition[16] = { 0, 1, -1, 0, -1, 0, 0, 1, 1, 0, 0, -1, 0, -1, 1, 0 };
+
+jog_wheel         jogWheels[JOG_WHEELS];
+volatile byte     jogWheelsCount  = 0;
+
+//
+//  Detach all the jog wheels
+//
+void jog_reset()
+{
+#ifdef ARDUINO_MEGA
+  PCICR  &= ~((1 << PCIE0) | (1 << PCIE2));
+  PCMSK0  = 0;
+  PCMSK2  = 0;
+#endif
+  jogWheelsCount = 0;
+}
+
+//
+//  Read channels A and B (interrupt only)
+//
+inline byte jog_level(const jog_wheel &w)
+{
+  return ((*w.portA & w.maskA) ? 2 : 0) | ((*w.portB & w.maskB) ? 1 : 0);
+}
+
+#ifdef ARDUINO_MEGA
+//
+//  Enable the pin change interrupt of a pin, if any
+//
+void jog_pin_change(byte pin)
+{
+  volatile uint8_t *pcicr = digitalPinToPCICR(pin);
+
+  if (pcicr == 0) return;
+  if (digitalPinToPCICRbit(pin) == PCIE1) return;       // PORTJ and PE0, not used by pedals
+  *digitalPinToPCMSK(pin) |= (1 << digitalPinToPCMSKbit(pin));
+  *pcicr |= (1 << digitalPinToPCICRbit(pin));
+}
+#endif
+
+//
+//  Attach a jog wheel to two pins already configured as input (sampling interrupt stopped)
+//
+void jog_attach(byte pedal, byte pinA, byte pinB)
+{
+  if (jogWheelsCount >= JOG_WHEELS) return;
+
+  jog_wheel &w = jogWheels[jogWheelsCount];
+  w.portA    = portInputRegister(digitalPinToPort(pinA));
+  w.maskA    = digitalPinToBitMask(pinA);
+  w.portB    = portInputRegister(digitalPinToPort(pinB));
+  w.maskB    = digitalPinToBitMask(pinB);
+  w.pedal    = pedal;
+  w.state    = jog_level(w);
+  w.position = 0;
+  w.last     = 0;
+  w.rest     = 0;
+  jogWheelsCount++;
+
+#ifdef ARDUINO_MEGA
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    jog_pin_change(pinA);
+    jog_pin_change(pinB);
+  }
+#endif
+}
+
+//
+//  Decode all the jog wheels (interrupt only)
+//
+void jog_sample()
+{
+  for (byte j = 0; j < jogWheelsCount; j++) {
+    byte s = jog_level(jogWheels[j]);
+    if (s == jogWheels[j].state) continue;
+    jogWheels[j].position += jogTransition[(jogWheels[j].state << 2) | s];
+    jogWheels[j].state     = s;
+  }
+}
+
+//
+//  Detents moved since the previous reading (main loop only)
+//
+int jog_read(byte pedal)
+{
+  for (byte j = 0; j < jogWheelsCount; j++) {
+    if (jogWheels[j].pedal != pedal) continue;
+
+    int8_t position = jogWheels[j].position;            // a single byte is read atomically
+    int    steps    = (int8_t)(position - jogWheels[j].last) + jogWheels[j].rest;
+
+    jogWheels[j].last = position;
+    jogWheels[j].rest = steps % JOG_STEPS_PER_DETENT;
+    return steps / JOG_STEPS_PER_DETENT;
+  }
+  return 0;
+}
+
+//
+//  Step multiplier for the speed of the wheel
+//
+byte jog_acceleration(unsigned long interval, int detents)
+{
+  interval /= abs(detents);                             // ms per detent
+  if (interval < JOG_ACCEL_FAST)   return 8;
+  if (interval < JOG_ACCEL_MEDIUM) return 4;
+  if (interval < JOG_ACCEL_SLOW)   return 2;
+  return 1;
+}
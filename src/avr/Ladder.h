@@ -0,0 +1,242 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+//
+//  Resistor ladder decoder
+//
+//  Every button of a ladder pulls the analog input to its own level. The layout of a pedal
+//  (ladders[], saved in EEPROM) has the level and the tolerance of each button as learned by
+//  calibrate_ladder(); pedals without a layout use the LCD Keypad Shield table kt[].
+//
+//  controller_setup() compiles each layout into a table of bands sorted by level, so a reading
+//  is decoded with a binary search: the cost grows with the logarithm of the buttons.
+//  Two buttons held together get a band too when the ladder allows it. With buttons wired in
+//  parallel (each one connects its own resistor to GND against the pull-up) the conductances
+//  add up, so the level of a pair is known from the levels of the two buttons:
+//      Vab = Vmax / (1 + (Vmax / Va - 1) + (Vmax / Vb - 1))
+//  A pair is added only if its band does not overlap any other band, so ladders where a pair
+//  reads as one of the buttons (buttons in series, like the Keypad Shield) get no pair bands.
+//
+
+#define LADDER_BANDS          20                // max bands (buttons and pairs) of a decoder
+#define LADDER_NONE           0xFF              // no band
+#define LADDER_STABLE         2                 // analog scanner sets to accept a new reading
+#define LADDER_MIN_TOLERANCE  4                 // smallest tolerance of a learned button
+
+struct ladder_band {
+  unsigned int           low;                   // band [low, high]
+  unsigned int           high;
+  byte                   keys;                  // button (low nibble) and second button + 1 (high nibble, 0 = none)
+};
+
+struct ladder_decoder {
+  byte                   pedal;                 // 0xFF = free
+  byte                   count;                 // bands
+  ladder_band            bands[LADDER_BANDS];   // sorted by level, not overlapping
+  unsigned int           keys;                  // buttons held (bit mask)
+  unsigned int           candidate;             // last reading (bit mask)
+  byte                   stable;                // consecutive sets with the same reading
+  byte                   set;                   // last analog scanner set decoded
+};
+
+ladder_decoder    ladderDecoders[LADDERS];
+
+//
+//  Free all the decoders
+//
+void ladder_reset()
+{
+  for (byte d = 0; d < LADDERS; d++)
+    ladderDecoders[d].pedal = LADDER_NONE;
+}
+
+//
+//  Layout slot of a pedal, LADDER_NONE if none
+//
+byte ladder_layout(byte pedal)
+{
+  for (byte l = 0; l < LADDERS; l++)
+    if (ladders[l].pedal == pedal && ladders[l].keys > 0) return l;
+  return LADDER_NONE;
+}
+
+//
+//  Decoder of a pedal, LADDER_NONE if none
+//
+byte ladder_decoder_of(byte pedal)
+{
+  for (byte d = 0; d < LADDERS; d++)
+    if (ladderDecoders[d].pedal == pedal) return d;
+  return LADDER_NONE;
+}
+
+//
+//  Add a band keeping the table sorted, false if it overlaps another band or the table is full
+//
+bool ladder_add_band(ladder_decoder &d, unsigned int level, unsigned int tolerance, byte keys)
+{
+  unsigned int  low  = (level > tolerance) ? level - tolerance : 0;
+  unsigned int  high = min(level + tolerance, ADC_RESOLUTION - 1);
+  byte          b;
+
+  if (d.count >= LADDER_BANDS) return false;
+  for (b = 0; b < d.count && d.bands[b].high < low; b++);
+  if (b < d.count && d.bands[b].low <= high) return false;
+  for (byte i = d.count; i > b; i--)
+    d.bands[i] = d.bands[i - 1];
+  d.bands[b].low  = low;
+  d.bands[b].high = high;
+  d.bands[b].keys = keys;
+  d.count++;
+  return true;
+}
+
+//
+//  Compile the layout of a pedal into a free decoder, LADDER_NONE if none is free
+//
+byte ladder_setup(byte pedal)
+{
+  byte          d = ladder_decoder_of(LADDER_NONE);
+  byte          l = ladder_layout(pedal);
+  byte          keys;
+  unsigned int  level[LADDER_KEYS];
+  unsigned int  tolerance[LADDER_KEYS];
+  unsigned long x[LADDER_KEYS];
+
+  if (d == LADDER_NONE) return LADDER_NONE;
+
+  if (l == LADDER_NONE) {
+    keys = min(ARRAY_SIZE(kt), LADDER_KEYS);
+    for (byte k = 0; k < keys; k++) {
+      level[k]     = kt[k].adcThreshold;
+      tolerance[k] = kt[k].adcTolerance;
+    }
+  }
+  else {
+    keys = min(ladders[l].keys, LADDER_KEYS);
+    for (byte k = 0; k < keys; k++) {
+      level[k]     = ladders[l].threshold[k];
+      tolerance[k] = ladders[l].tolerance[k];
+    }
+  }
+
+  ladder_decoder &decoder = ladderDecoders[d];
+  decoder.pedal     = pedal;
+  decoder.count     = 0;
+  decoder.keys      = 0;
+  decoder.candidate = 0;
+  decoder.stable    = 0;
+  decoder.set       = adc_set();
+
+  for (byte k = 0; k < keys; k++)
+    ladder_add_band(decoder, level[k], tolerance[k], k);
+
+  // Pairs of buttons wired in parallel, conductances in units of the pull-up (8 fractional bits)
+  // The Keypad Shield is wired in series: no pairs
+  if (l != LADDER_NONE) {
+    for (byte k = 0; k < keys; k++)
+      x[k] = (level[k] > 0) ? ((unsigned long)(ADC_RESOLUTION - 1) << 8) / level[k] - 256 : 0;
+    for (byte a = 0; a < keys; a++)
+      for (byte b = a + 1; b < keys; b++) {
+        if (level[a] == 0 || level[b] == 0) continue;
+        ladder_add_band(decoder,
+                        ((unsigned long)(ADC_RESOLUTION - 1) << 8) / (256 + x[a] + x[b]),
+                        max(tolerance[a], tolerance[b]),
+                        a | ((b + 1) << 4));
+      }
+  }
+
+  DPRINTF("   Ladder bands ");
+  DPRINT(decoder.count);
+  return d;
+}
+
+//
+//  Band of a reading, LADDER_NONE if none (binary search)
+//
+byte ladder_search(const ladder_decoder &d, unsigned int value)
+{
+  byte lo = 0;
+  byte hi = d.count;
+
+  while (lo < hi) {
+    byte mid = (lo + hi) / 2;
+    if (d.bands[mid].high < value) lo = mid + 1;
+    else hi = mid;
+  }
+  return (lo < d.count && d.bands[lo].low <= value) ? lo : LADDER_NONE;
+}
+
+//
+//  Buttons of a band (bit mask)
+//
+unsigned int ladder_keys(byte keys)
+{
+  unsigned int mask = 1U << (keys & 0x0F);
+
+  if (keys >> 4) mask |= 1U << ((keys >> 4) - 1);
+  return mask;
+}
+
+//
+//  Decode the last reading of a ladder, true when the buttons held changed (main loop only)
+//
+bool ladder_read(byte d, byte pin)
+{
+  ladder_decoder &decoder = ladderDecoders[d];
+  byte            set     = adc_set();
+  byte            band;
+  unsigned int    keys;
+
+  if (set == decoder.set) return false;                 // same reading of the previous call
+  decoder.set = set;
+
+  band = ladder_search(decoder, adc_read(pin));
+  keys = (band == LADDER_NONE) ? 0 : ladder_keys(decoder.bands[band].keys);
+  if (keys != decoder.candidate) {
+    decoder.candidate = keys;
+    decoder.stable    = 0;
+  }
+  if (decoder.stable < LADDER_STABLE && ++decoder.stable == LADDER_STABLE && keys != decoder.keys) {
+    decoder.keys = keys;
+    return true;
+  }
+  return false;
+}
+
+//
+//  Resistor ladder keypad for the menu, single buttons only
+//
+class LadderSwitch : public MD_UISwitch
+{
+  public:
+    LadderSwitch(uint8_t pin, byte decoder) :
+      _pin(pin), _decoder(decoder), _lastIdx(LADDER_NONE) {};
+
+    keyResult_t read(void)
+    {
+      byte  idx = LADDER_NONE;
+
+      if (_decoder != LADDER_NONE) {
+        byte band = ladder_search(ladderDecoders[_decoder], adc_read(_pin));
+        if (band != LADDER_NONE && (ladderDecoders[_decoder].bands[band].keys >> 4) == 0)
+          idx = ladderDecoders[_decoder].bands[band].keys;
+      }
+
+      keyResult_t k = processFSM(idx != LADDER_NONE, idx != _lastIdx && idx != LADDER_NONE && _lastIdx != LADDER_NONE);
+      if (idx != LADDER_NONE) _lastKey = (idx < ARRAY_SIZE(kt)) ? kt[idx].value : '1' + idx;
+      _lastIdx = idx;
+      return k;
+    };
+
+  private:
+    uint8_t   _pin;
+    byte      _decoder;
+    byte      _lastIdx;
+};
@@ -0,0 +1,366 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Latency instrumentation (build flag LATENCY_PEDALINO)
+//
+//  Every pedal event handled by midi_refresh() gets a record with the micros() of each stage:
+//
+//    detected    first edge seen by the sampling interrupt (1 ms resolution)
+//    debounced   change accepted and queued by the sampling interrupt
+//    mapped      event decoded into a MIDI value by its handler
+//    send        midi_send() entry
+//    uart        last byte of the last message written into a UART buffer by the output ports
+//
+//  The last LATENCY_RECORDS records are kept in a ring buffer. Completed records are added to
+//  a histogram per segment (each stage from the previous one, plus the total), with 4 buckets
+//  per octave of microseconds. The oldest samples fade out: counts are halved when a segment
+//  reaches LATENCY_MAX_COUNT samples. Pedals polled every loop start their record at the
+//  first stage they stamp, the segments they miss are not counted.
+//
+//  The uart stage is stamped by MidiPort::pump() (MidiPort.h), possibly from the sampling
+//  interrupt and after the handler returned: the record waits in latencySending and is counted
+//  by the next latency_end(). A record still waiting when the next event sends is dropped.
+//
+//  The statistics are exported as JSON, in a SysEx message to USB and ESP like the other
+//  serialize_*() messages, or as text lines to the debug serial port. The Latency menu page
+//  shows them on the LCD. Meant for the MEGA: the tables take about 1.2 KB of SRAM.
+//
+
+#ifdef LATENCY_PEDALINO
+
+#define LATENCY_DETECTED    0
+#define LATENCY_DEBOUNCED   1
+#define LATENCY_MAPPED      2
+#define LATENCY_SEND        3
+#define LATENCY_UART        4
+#define LATENCY_STAMPS      5
+
+#define LATENCY_SEGMENTS    LATENCY_STAMPS        // stage-to-stage segments plus the total (index 0)
+#define LATENCY_RECORDS     16                    // must be a power of 2
+#define LATENCY_BUCKETS     64                    // last bucket starts at 114.688 ms
+#define LATENCY_MAX_COUNT   16384                 // halve the histogram at this count
+#define LATENCY_MAX_US      131071UL              // longer samples are clamped
+#define LATENCY_PAGE_TIME   2000                  // ms for each segment in the menu page
+
+#define LATENCY_BEGIN(p, e) latency_begin(p, e)
+#define LATENCY_POLL(p)     latency_begin(p)
+#define LATENCY_STAMP(s)    latency_stamp(s)
+#define LATENCY_MARK(ports) latency_mark(ports)
+#define LATENCY_END()       latency_end()
+
+struct latency_record {
+  byte                   pedal;
+  byte                   stamped;                 // stages stamped (bit mask)
+  unsigned long          stamp[LATENCY_STAMPS];   // micros()
+};
+
+struct latency_stats {
+  unsigned int           count;
+  unsigned long          min;
+  unsigned long          max;
+  unsigned long          sum;
+  unsigned int           bucket[LATENCY_BUCKETS];
+};
+
+const char *latencyNames[LATENCY_SEGMENTS] = { "total", "debounce", "mapping", "send", "uart" };
+
+latency_record   latencyRecords[LATENCY_RECORDS];
+byte             latencyHead      = 0;            // next record of the ring
+latency_record  *latencyRecord    = nullptr;      // record of the event in progress
+byte             latencyPedal     = 0xFF;         // pedal of the event in progress, 0xFF if none
+unsigned long    latencyStart[2];                 // detected and debounced stamps of the event
+byte             latencyStarted   = 0;            // stages in latencyStart[] (bit mask)
+latency_stats    latencyStats[LATENCY_SEGMENTS];
+latency_record * volatile latencySending = nullptr;  // record waiting for its uart stamp
+
+//
+//  Histogram bucket: exact below 4 us, then 4 buckets per octave
+//
+byte latency_bucket(unsigned long us)
+{
+  byte octave = 0;
+
+  if (us < 4) return us;
+  while (us >= 8) {
+    us >>= 1;
+    octave++;
+  }
+  return min(4 * (octave + 1) + (byte)(us - 4), LATENCY_BUCKETS - 1);
+}
+
+//
+//  Lowest microseconds of a bucket
+//
+unsigned long latency_bucket_low(byte b)
+{
+  if (b < 4) return b;
+  return (unsigned long)(4 + (b & 3)) << (b / 4 - 1);
+}
+
+//
+//  Clear statistics and records
+//
+void latency_reset()
+{
+  memset(latencyStats, 0, sizeof(latencyStats));
+  memset(latencyRecords, 0, sizeof(latencyRecords));
+  for (byte s = 0; s < LATENCY_SEGMENTS; s++) latencyStats[s].min = LATENCY_MAX_US;
+  latencyRecord  = nullptr;
+  latencyPedal   = 0xFF;
+  latencySending = nullptr;
+}
+
+//
+//  Start the record of a pedal event (debounced switch) or of a polled pedal
+//
+void latency_begin(byte pedal, const pedal_event &e)
+{
+  latencyPedal    = pedal;
+  latencyRecord   = nullptr;
+  latencyStart[0] = e.edge;
+  latencyStart[1] = e.debounced;
+  latencyStarted  = bit(LATENCY_DETECTED) | bit(LATENCY_DEBOUNCED);
+}
+
+void latency_begin(byte pedal)
+{
+  latencyPedal   = pedal;
+  latencyRecord  = nullptr;
+  latencyStarted = 0;
+}
+
+//
+//  Stamp a stage of the event in progress, the first stamp of each stage wins
+//
+void latency_stamp(byte stage)
+{
+  latency_record *r = latencyRecord;
+
+  if (latencyPedal == 0xFF) return;                // not a pedal event
+  if (r == nullptr) {                              // first stamp allocates the record
+    r = latencyRecord = &latencyRecords[latencyHead];
+    latencyHead = (latencyHead + 1) & (LATENCY_RECORDS - 1);
+    if (r == latencySending) latencySending = nullptr;   // still waiting, reused
+    r->pedal    = latencyPedal;
+    r->stamped  = latencyStarted;
+    r->stamp[LATENCY_DETECTED]  = latencyStart[0];
+    r->stamp[LATENCY_DEBOUNCED] = latencyStart[1];
+  }
+  if (r->stamped & bit(stage)) return;
+  r->stamp[stage] = micros();
+  r->stamped |= bit(stage);
+}
+
+//
+//  Messages of the event in progress queued to the ports in the mask (MidiPort.h): the uart stage
+//  is stamped when the first port writes the last byte of the last one
+//
+void latency_mark(byte ports)
+{
+  latency_record *r = latencyRecord;
+
+  if (r == nullptr) return;                        // not a pedal event
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    r->stamped &= ~bit(LATENCY_UART);
+    latencySending = r;
+  }
+  if (ports & bit(MIDI_PORT_USB)) usbPort.mark();
+  if (ports & bit(MIDI_PORT_DIN)) dinPort.mark();
+  if (ports & bit(MIDI_PORT_ESP)) espPort.mark();
+}
+
+//
+//  Uart stage of the record waiting, called by the ports with interrupts masked
+//
+void latency_uart()
+{
+  latency_record *r = latencySending;
+
+  if (r == nullptr || (r->stamped & bit(LATENCY_UART))) return;
+  r->stamp[LATENCY_UART] = micros();
+  r->stamped |= bit(LATENCY_UART);
+}
+
+//
+//  Add a sample to the histogram of a segment
+//
+void latency_add(byte segment, unsigned long us)
+{
+  latency_stats &s = latencyStats[segment];
+
+  us = min(us, LATENCY_MAX_US);
+  if (s.count == LATENCY_MAX_COUNT) {              // fade out the oldest samples
+    s.count >>= 1;
+    s.sum   >>= 1;
+    for (byte b = 0; b < LATENCY_BUCKETS; b++) s.bucket[b] >>= 1;
+  }
+  s.count++;
+  s.sum += us;
+  s.min  = min(s.min, us);
+  s.max  = max(s.max, us);
+  s.bucket[latency_bucket(us)]++;
+}
+
+//
+//  Close the event in progress, add the segments of the record waiting once its messages are out
+//
+void latency_end()
+{
+  latency_record *r;
+  byte            first;
+  byte            prev;
+
+  latencyPedal  = 0xFF;
+  latencyRecord = nullptr;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    r = latencySending;
+    if (r != nullptr && (r->stamped & bit(LATENCY_UART))) latencySending = nullptr;
+    else r = nullptr;                              // nothing sent, or still in the rings
+  }
+  if (r == nullptr) return;
+
+  for (first = 0; !(r->stamped & bit(first)); first++);
+  prev = first;
+  for (byte stage = first + 1; stage < LATENCY_STAMPS; stage++) {
+    if (!(r->stamped & bit(stage))) continue;
+    if (stage == prev + 1) latency_add(stage, r->stamp[stage] - r->stamp[prev]);
+    prev = stage;
+  }
+  if (first == LATENCY_DETECTED) latency_add(0, r->stamp[LATENCY_UART] - r->stamp[LATENCY_DETECTED]);
+}
+
+//
+//  99th percentile of a segment (upper bound of its bucket, never above the max)
+//
+unsigned long latency_p99(byte segment)
+{
+  const latency_stats &s = latencyStats[segment];
+  unsigned int         above = 0;
+  byte                 b;
+
+  if (s.count == 0) return 0;
+  for (b = LATENCY_BUCKETS - 1; b > 0 && above + s.bucket[b] <= s.count / 100; b--)
+    above += s.bucket[b];
+  if (b == LATENCY_BUCKETS - 1) return s.max;
+  return min(latency_bucket_low(b + 1) - 1, s.max);
+}
+
+//
+//  JSON statistics of one segment: {"latency":"debounce","n":12,"min":..,"avg":..,"max":..,"p99":..,"hist":[low,count,...]}
+//
+void latency_print(Print &out, byte segment)
+{
+  const latency_stats &s = latencyStats[segment];
+  bool                 comma = false;
+
+  out.print(F("{\"latency\":\""));
+  out.print(latencyNames[segment]);
+  out.print(F("\",\"n\":"));
+  out.print(s.count);
+  out.print(F(",\"min\":"));
+  out.print(s.count ? s.min : 0);
+  out.print(F(",\"avg\":"));
+  out.print(s.count ? s.sum / s.count : 0);
+  out.print(F(",\"max\":"));
+  out.print(s.max);
+  out.print(F(",\"p99\":"));
+  out.print(latency_p99(segment));
+  out.print(F(",\"hist\":["));
+  for (byte b = 0; b < LATENCY_BUCKETS; b++) {
+    if (s.bucket[b] == 0) continue;
+    if (comma) out.print(',');
+    out.print(latency_bucket_low(b));
+    out.print(',');
+    out.print(s.bucket[b]);
+    comma = true;
+  }
+  out.print(F("]}"));
+}
+
+//
+//  Messages dropped by the output rings (MidiPort.h): {"overflow":{"usb":0,"din":0,"esp":0}}
+//
+void latency_print_overflows(Print &out)
+{
+  out.print(F("{\"overflow\":{\"usb\":"));
+  out.print(usbPort.overflows);
+  out.print(F(",\"din\":"));
+  out.print(dinPort.overflows);
+  out.print(F(",\"esp\":"));
+  out.print(espPort.overflows);
+  out.print(F("}}"));
+}
+
+//
+//  Export all the segments and the overflows: a SysEx message each to USB and ESP, text lines
+//  on debug serial
+//
+void latency_export()
+{
+  for (byte s = 0; s <= LATENCY_SEGMENTS; s++) {
+#ifdef DEBUG_PEDALINO
+    if (s < LATENCY_SEGMENTS) latency_print(SERIALDEBUG, s);
+    else                      latency_print_overflows(SERIALDEBUG);
+    SERIALDEBUG.println();
+#else
+    usbPort.hold();
+    Serial.write(0xF0);
+    if (s < LATENCY_SEGMENTS) latency_print(Serial, s);
+    else                      latency_print_overflows(Serial);
+    Serial.write(0xF7);
+    usbPort.resume();
+#endif
+    espPort.hold();
+    Serial3.write(0xF0);
+    if (s < LATENCY_SEGMENTS) latency_print(Serial3, s);
+    else                      latency_print_overflows(Serial3);
+    Serial3.write(0xF7);
+    espPort.resume();
+  }
+}
+
+#ifndef NOLCD
+//
+//  Latency menu page: average, p99 and max of each segment, then export them all
+//
+void latency_show()
+{
+  for (byte s = 0; s < LATENCY_SEGMENTS; s++) {
+    lcd.clear();
+    lcd.print(latencyNames[s]);
+    lcd.print(" n=");
+    lcd.print(latencyStats[s].count);
+    lcd.setCursor(0, 1);
+    if (latencyStats[s].count) {
+      lcd.print(latencyStats[s].sum / latencyStats[s].count / 1000.0, 1);
+      lcd.print('/');
+      lcd.print(latency_p99(s) / 1000.0, 1);
+      lcd.print('/');
+      lcd.print(latencyStats[s].max / 1000.0, 1);
+      lcd.print("ms");
+    }
+    delay(LATENCY_PAGE_TIME);
+  }
+  latency_export();
+}
+#endif
+
+#else
+
+#define LATENCY_BEGIN(...)
+#define LATENCY_POLL(...)
+#define LATENCY_STAMP(...)
+#define LATENCY_MARK(...)
+#define LATENCY_END(...)
+#define latency_reset(...)
+#define latency_show(...)
+
+#endif  // LATENCY_PEDALINO
@@ -57,123 +57,100 @@ void midi_routing()
     }
 }
 
-bool EspMidiRouting()
-{
-  return (interfaces[PED_RTPMIDI].midiRouting || interfaces[PED_IPMIDI].midiRouting || interfaces[PED_BLEMIDI].midiRouting || interfaces[PED_OSC].midiRouting);
-}
-
 void OnUsbMidiNoteOn(byte channel, byte note, byte velocity)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendNoteOn(note, velocity, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendNoteOn(note, velocity, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::NoteOn | (channel - 1), note, velocity);
 }
 
 void OnUsbMidiNoteOff(byte channel, byte note, byte velocity)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendNoteOff(note, velocity, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendNoteOff(note, velocity, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::NoteOff | (channel - 1), note, velocity);
 }
 
 void OnUsbMidiAfterTouchPoly(byte channel, byte note, byte pressure)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendAfterTouch(note, pressure, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendAfterTouch(note, pressure, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::AfterTouchPoly | (channel - 1), note, pressure);
 }
 
 void OnUsbMidiControlChange(byte channel, byte number, byte value)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendControlChange(number, value, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendControlChange(number, value, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::ControlChange | (channel - 1), number, value);
 }
 
 void OnUsbMidiProgramChange(byte channel, byte number)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendProgramChange(number, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendProgramChange(number, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::ProgramChange | (channel - 1), number);
 }
 
 void OnUsbMidiAfterTouchChannel(byte channel, byte pressure)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendAfterTouch(pressure, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendAfterTouch(pressure, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::AfterTouchChannel | (channel - 1), pressure);
 }
 
 void OnUsbMidiPitchBend(byte channel, int bend)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendPitchBend(bend, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendPitchBend(bend, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::PitchBend | (channel - 1), (bend + 8192) & 0x7F, (bend + 8192) >> 7);
 }
 
 void OnUsbMidiSystemExclusive(byte * array, unsigned size)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendSysEx(size, array);
-  if (EspMidiRouting())                    ESP_MIDI.sendSysEx(size, array);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], array, size);
   MTC.decodeMTCFullFrame(size, array);   
 }
 
 void OnUsbMidiTimeCodeQuarterFrame(byte data)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendTimeCodeQuarterFrame(data);
-  if (EspMidiRouting())                    ESP_MIDI.sendTimeCodeQuarterFrame(data);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::TimeCodeQuarterFrame, data);
   MTC.decodMTCQuarterFrame(data);
 }
 
 void OnUsbMidiSongPosition(unsigned int beats)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendSongPosition(beats);
-  if (EspMidiRouting())                    ESP_MIDI.sendSongPosition(beats);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::SongPosition, beats & 0x7F, beats >> 7);
 }
 
 void OnUsbMidiSongSelect(byte songnumber)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendSongSelect(songnumber);
-  if (EspMidiRouting())                    ESP_MIDI.sendSongSelect(songnumber);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::SongSelect, songnumber);
 }
 
 void OnUsbMidiTuneRequest(void)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendTuneRequest();
-  if (EspMidiRouting())                    ESP_MIDI.sendTuneRequest();
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::TuneRequest);
 }
 
 void OnUsbMidiClock(void)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::Clock);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::Clock);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::Clock);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) bpm = MTC.tapTempo();
 }
 
 void OnUsbMidiStart(void)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::Start);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::Start);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::Start);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendPlay();
 }
 
 void OnUsbMidiContinue(void)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::Continue);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::Continue);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::Continue);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendContinue();
 }
 
 void OnUsbMidiStop(void)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::Stop);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::Stop);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::Stop);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendStop();
 }
 
 void OnUsbMidiActiveSensing(void)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::ActiveSensing);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::ActiveSensing);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::ActiveSensing);
 }
 
 void OnUsbMidiSystemReset(void)
 {
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::SystemReset);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::SystemReset);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_USB], midi::SystemReset);
 }
 
 
@@ -181,116 +158,98 @@ void OnUsbMidiSystemReset(void)
 
 void OnDinMidiNoteOn(byte channel, byte note, byte velocity)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendNoteOn(note, velocity, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendNoteOn(note, velocity, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::NoteOn | (channel - 1), note, velocity);
 }
 
 void OnDinMidiNoteOff(byte channel, byte note, byte velocity)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendNoteOff(note, velocity, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendNoteOff(note, velocity, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::NoteOff | (channel - 1), note, velocity);
 }
 
 void OnDinMidiAfterTouchPoly(byte channel, byte note, byte pressure)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendAfterTouch(note, pressure, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendAfterTouch(note, pressure, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::AfterTouchPoly | (channel - 1), note, pressure);
 }
 
 void OnDinMidiControlChange(byte channel, byte number, byte value)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendControlChange(number, value, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendControlChange(number, value, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::ControlChange | (channel - 1), number, value);
 }
 
 void OnDinMidiProgramChange(byte channel, byte number)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendProgramChange(number, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendProgramChange(number, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::ProgramChange | (channel - 1), number);
 }
 
 void OnDinMidiAfterTouchChannel(byte channel, byte pressure)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendAfterTouch(pressure, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendAfterTouch(pressure, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::AfterTouchChannel | (channel - 1), pressure);
 }
 
 void OnDinMidiPitchBend(byte channel, int bend)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendPitchBend(bend, channel);
-  if (EspMidiRouting())                    ESP_MIDI.sendPitchBend(bend, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::PitchBend | (channel - 1), (bend + 8192) & 0x7F, (bend + 8192) >> 7);
 }
 
 void OnDinMidiSystemExclusive(byte * array, unsigned size)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendSysEx(size, array);
-  if (EspMidiRouting())                    ESP_MIDI.sendSysEx(size, array);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], array, size);
   MTC.decodeMTCFullFrame(size, array);
 }
 
 void OnDinMidiTimeCodeQuarterFrame(byte data)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendTimeCodeQuarterFrame(data);
-  if (EspMidiRouting())                    ESP_MIDI.sendTimeCodeQuarterFrame(data);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::TimeCodeQuarterFrame, data);
   MTC.decodMTCQuarterFrame(data);
 }
 
 void OnDinMidiSongPosition(unsigned int beats)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendSongPosition(beats);
-  if (EspMidiRouting())                    ESP_MIDI.sendSongPosition(beats);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::SongPosition, beats & 0x7F, beats >> 7);
 }
 
 void OnDinMidiSongSelect(byte songnumber)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendSongSelect(songnumber);
-  if (EspMidiRouting())                    ESP_MIDI.sendSongSelect(songnumber);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::SongSelect, songnumber);
 }
 
 void OnDinMidiTuneRequest(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendTuneRequest();
-  if (EspMidiRouting())                    ESP_MIDI.sendTuneRequest();
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::TuneRequest);
 }
 
 void OnDinMidiClock(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::Clock);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::Clock);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::Clock);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) bpm = MTC.tapTempo();
 }
 
 void OnDinMidiStart(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::Start);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::Start);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::Start);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendPlay();
 }
 
 void OnDinMidiContinue(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::Continue);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::Continue);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::Continue);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendContinue();
 }
 
 void OnDinMidiStop(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::Stop);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::Stop);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::Stop);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendStop();
 }
 
 void OnDinMidiActiveSensing(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::ActiveSensing);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::ActiveSensing);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::ActiveSensing);
 }
 
 void OnDinMidiSystemReset(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::SystemReset);
-  if (EspMidiRouting())                    ESP_MIDI.sendRealTime(midi::SystemReset);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_DIN], midi::SystemReset);
 }
 
 
@@ -298,109 +257,92 @@ void OnDinMidiSystemReset(void)
 
 void OnEspMidiNoteOn(byte channel, byte note, byte velocity)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendNoteOn(note, velocity, channel);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendNoteOn(note, velocity, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::NoteOn | (channel - 1), note, velocity);
 }
 
 void OnEspMidiNoteOff(byte channel, byte note, byte velocity)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendNoteOff(note, velocity, channel);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendNoteOff(note, velocity, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::NoteOff | (channel - 1), note, velocity);
 }
 
 void OnEspMidiReceiveAfterTouchPoly(byte channel, byte note, byte pressure)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendAfterTouch(note, pressure, channel);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendAfterTouch(note, pressure, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::AfterTouchPoly | (channel - 1), note, pressure);
 }
 
 void OnEspMidiReceiveControlChange(byte channel, byte number, byte value)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendControlChange(number, value, channel);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendControlChange(number, value, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::ControlChange | (channel - 1), number, value);
 }
 
 void OnEspMidiReceiveProgramChange(byte channel, byte number)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendProgramChange(number, channel);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendProgramChange(number, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::ProgramChange | (channel - 1), number);
 }
 
 void OnEspMidiReceiveAfterTouchChannel(byte channel, byte pressure)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendAfterTouch(pressure, channel);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendAfterTouch(pressure, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::AfterTouchChannel | (channel - 1), pressure);
 }
 
 void OnEspMidiReceivePitchBend(byte channel, int bend)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendPitchBend(bend, channel);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendPitchBend(bend, channel);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::PitchBend | (channel - 1), (bend + 8192) & 0x7F, (bend + 8192) >> 7);
 }
 
 void OnEspMidiReceiveTimeCodeQuarterFrame(byte data)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendTimeCodeQuarterFrame(data);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendTimeCodeQuarterFrame(data);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::TimeCodeQuarterFrame, data);
   MTC.decodMTCQuarterFrame(data);
 }
 
 void OnEspMidiReceiveSongPosition(unsigned int beats)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendSongPosition(beats);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendSongPosition(beats);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::SongPosition, beats & 0x7F, beats >> 7);
 }
 
 void OnEspMidiReceiveSongSelect(byte songnumber)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendSongSelect(songnumber);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendSongSelect(songnumber);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::SongSelect, songnumber);
 }
 
 void OnEspMidiReceiveTuneRequest(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendTuneRequest();
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendTuneRequest();
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::TuneRequest);
 }
 
 void OnEspMidiReceiveClock(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::Clock);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::Clock);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::Clock);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) bpm = MTC.tapTempo();
 }
 
 void OnEspMidiReceiveStart(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::Start);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::Start);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::Start);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendPlay();
 }
 
 void OnEspMidiReceiveContinue(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::Continue);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::Continue);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::Continue);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendContinue();
 }
 
 void OnEspMidiReceiveStop(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::Stop);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::Stop);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::Stop);
   if (MTC.getMode() == MidiTimeCode::SynchroClockSlave) MTC.sendStop();
 }
 
 void OnEspMidiReceiveActiveSensing(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::ActiveSensing);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::ActiveSensing);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::ActiveSensing);
 }
 
 void OnEspMidiReceiveReset(void)
 {
-  if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendRealTime(midi::SystemReset);
-  if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendRealTime(midi::SystemReset);
+  midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], midi::SystemReset);
 }
 
 void OnEspMidiReceiveSysEx(byte *data, unsigned int size)
@@ -413,7 +355,7 @@ void OnEspMidiReceiveSysEx(byte *data, unsigned int size)
   DPRINTLN(json);
 
   // Memory pool for JSON object tree.
-  StaticJsonBuffer<200> jsonBuffer;
+  StaticJsonBuffer<300> jsonBuffer;
 
   // Root of the object tree.
   JsonObject& root = jsonBuffer.parseObject(json);
@@ -428,8 +370,41 @@ void OnEspMidiReceiveSysEx(byte *data, unsigned int size)
     else if (root.containsKey("ready")) {
       serialize_banks();
       serialize_pedals();
+      serialize_chords();
+      serialize_macros();
       serialize_interfaces();
     }
+    else if (root.containsKey("chord")) {
+      byte c = root["chord"];
+      if (c < CHORDS) {
+        JsonArray& messages = root["messages"];
+        chords[c].pedals   = root["pedals"];
+        chords[c].messages = min(messages.size(), CHORD_MESSAGES);
+        for (byte m = 0; m < chords[c].messages; m++) {
+          chords[c].message[m].midiMessage = constrain((int)messages[m][0], 0, PED_MACRO);
+          chords[c].message[m].midiChannel = constrain((int)messages[m][1], 1, 16);
+          chords[c].message[m].midiCode    = messages[m][2];
+          chords[c].message[m].midiValue   = messages[m][3];
+        }
+        update_eeprom();
+        controller_setup();
+      }
+    }
+    else if (root.containsKey("macro")) {
+      byte m = root["macro"];
+      if (m < MACROS) {
+        JsonArray& messages = root["messages"];
+        macros[m].messages = min(messages.size(), MACRO_MESSAGES);
+        for (byte i = 0; i < macros[m].messages; i++) {
+          macros[m].message[i].midiMessage = constrain((int)messages[i][0], 0, PED_CONTROL_CHANGE_RELATIVE);
+          macros[m].message[i].midiChannel = constrain((int)messages[i][1], 1, 16);
+          macros[m].message[i].midiCode    = messages[i][2];
+          macros[m].message[i].midiValue   = messages[i][3];
+        }
+        update_eeprom();
+        macro_setup();
+      }
+    }
     else if (root.containsKey("wifi.on")) {
       
     }
@@ -442,9 +417,13 @@ void OnEspMidiReceiveSysEx(byte *data, unsigned int size)
     else if (root.containsKey("ble.connected")) {
       bleConnected = root["ble.connected"];
     }
+#ifdef LATENCY_PEDALINO
+    else if (root.containsKey("latency")) {
+      latency_export();
+    }
+#endif
     else {
-      if (interfaces[PED_USBMIDI].midiRouting) USB_MIDI.sendSysEx(size, data);
-      if (interfaces[PED_DINMIDI].midiRouting) DIN_MIDI.sendSysEx(size, data);
+      midi_ports_send(midiRoutePorts[MIDI_PORT_ESP], data, size);
       MTC.decodeMTCFullFrame(size, data);
     }
   }
@@ -0,0 +1,88 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Macros
+//
+//  A macro is a list of up to MACRO_MESSAGES messages (macros[], saved in EEPROM) sent by any
+//  pedal gesture whose bank message is Macro: the value of the gesture (Value 1, 2 or 3) is the
+//  macro number, 0 sends nothing. macro_setup() encodes every macro into the raw MIDI bytes of
+//  its messages, so switching a rig is a single queued write per port (MidiPort.h) and reaches
+//  every device in the same transmit burst.
+//
+
+#define MACRO_BLOB          (6 * MACRO_MESSAGES)          // a 14-bit Control Change takes 6 bytes
+
+byte              macroBlob[MACROS][MACRO_BLOB];        // raw MIDI bytes of each macro
+byte              macroBlobSize[MACROS];
+
+//
+//  Raw bytes of a message, the same midi_send() would send, returns their number
+//
+byte macro_encode(const macro_message &m, byte *out)
+{
+  byte          channel = (m.midiChannel - 1) & 0x0F;
+  byte          code    = m.midiCode & 0x7F;
+  byte          value   = min(m.midiValue, 127);
+  unsigned int  value14 = map(value, 0, 127, 0, MIDI_RESOLUTION_14BIT - 1);
+  byte          n       = 0;
+
+  switch (m.midiMessage) {
+
+    case PED_PROGRAM_CHANGE:
+      out[n++] = midi::ProgramChange | channel;
+      out[n++] = code;
+      break;
+
+    case PED_CONTROL_CHANGE:
+    case PED_CONTROL_CHANGE_RELATIVE:
+      out[n++] = midi::ControlChange | channel;
+      out[n++] = code;
+      out[n++] = value;
+      break;
+
+    case PED_NOTE_ON_OFF:
+      out[n++] = (value > 0 ? midi::NoteOn : midi::NoteOff) | channel;
+      out[n++] = code;
+      out[n++] = value;
+      break;
+
+    case PED_PITCH_BEND:
+    case PED_PITCH_BEND_14BIT:
+      out[n++] = midi::PitchBend | channel;
+      out[n++] = value14 & 0x7F;
+      out[n++] = value14 >> 7;
+      break;
+
+    case PED_CONTROL_CHANGE_14BIT:
+      out[n++] = midi::ControlChange | channel;
+      out[n++] = code;
+      out[n++] = value14 >> 7;
+      if (code < 32) {                                  // no LSB controller for codes 32-127
+        out[n++] = midi::ControlChange | channel;
+        out[n++] = code + 32;
+        out[n++] = value14 & 0x7F;
+      }
+      break;
+  }
+  return n;
+}
+
+//
+//  Encode all the macros
+//
+void macro_setup()
+{
+  for (byte m = 0; m < MACROS; m++) {
+    macroBlobSize[m] = 0;
+    for (byte i = 0; i < macros[m].messages; i++)
+      macroBlobSize[m] += macro_encode(macros[m].message[i], macroBlob[m] + macroBlobSize[m]);
+  }
+}
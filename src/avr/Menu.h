@@ -72,6 +72,15 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet);
 #define II_TIMESIGNATURE  56
 #define II_SERIALPASS     57
 #define II_DEFAULT        58
+#define II_CURVE0         59
+#define II_CURVE1         60
+#define II_CURVE2         61
+#define II_CURVE3         62
+#define II_CURVE4         63
+#define II_LATENCY        64
+#define II_SPECULATIVE    65
+#define II_FILTER_CUTOFF  66
+#define II_FILTER_BETA    67
 
 // Global menu data and definitions
 
@@ -82,11 +91,15 @@ const PROGMEM MD_Menu::mnuHeader_t mnuHdr[] =
 {
   { M_ROOT,           SIGNATURE,         10, 15, 0 },
   { M_BANKSETUP,      "Banks Setup",     20, 37, 0 },
-  { M_PEDALSETUP,     "Pedals Setup",    40, 49, 0 },
+  { M_PEDALSETUP,     "Pedals Setup",    40, 57, 0 },
   { M_INTERFACESETUP, "Interface Setup", 60, 65, 0 },
   { M_TEMPO,          "Tempo",           70, 72, 0 },
   { M_PROFILE,        "Profiles",        80, 81, 0 },
+#ifdef LATENCY_PEDALINO
+  { M_OPTIONS,        "Options",         90, 96, 0 }
+#else
   { M_OPTIONS,        "Options",         90, 95, 0 }
+#endif
 };
 
 // Menu Items ----------
@@ -120,6 +133,14 @@ const PROGMEM MD_Menu::mnuItem_t mnuItm[] =
   { 47, "Zero",            MD_Menu::MNU_INPUT, II_ZERO },
   { 48, "Max",             MD_Menu::MNU_INPUT, II_MAX },
   { 49, "Response Curve",  MD_Menu::MNU_INPUT, II_RESPONSECURVE },
+  { 50, "Curve 0%",        MD_Menu::MNU_INPUT, II_CURVE0 },
+  { 51, "Curve 25%",       MD_Menu::MNU_INPUT, II_CURVE1 },
+  { 52, "Curve 50%",       MD_Menu::MNU_INPUT, II_CURVE2 },
+  { 53, "Curve 75%",       MD_Menu::MNU_INPUT, II_CURVE3 },
+  { 54, "Curve 100%",      MD_Menu::MNU_INPUT, II_CURVE4 },
+  { 55, "Speculative",     MD_Menu::MNU_INPUT, II_SPECULATIVE },
+  { 56, "Smooth 0.1Hz",    MD_Menu::MNU_INPUT, II_FILTER_CUTOFF },
+  { 57, "Speed Boost",     MD_Menu::MNU_INPUT, II_FILTER_BETA },
   // Interface Setup
   { 60, "Select Interf.",  MD_Menu::MNU_INPUT, II_INTERFACE },
   { 61, "MIDI IN",         MD_Menu::MNU_INPUT, II_MIDI_IN },
@@ -140,16 +161,19 @@ const PROGMEM MD_Menu::mnuItem_t mnuItm[] =
 //  { 92, "LCD Backlight",   MD_Menu::MNU_INPUT, II_BACKLIGHT },
   { 93, "WiFi Reset",      MD_Menu::MNU_INPUT, II_WIFIRESET },
   { 94, "Firmware upload", MD_Menu::MNU_INPUT, II_SERIALPASS },
-  { 95, "Factory default", MD_Menu::MNU_INPUT, II_DEFAULT }
+  { 95, "Factory default", MD_Menu::MNU_INPUT, II_DEFAULT },
+#ifdef LATENCY_PEDALINO
+  { 96, "Latency",         MD_Menu::MNU_INPUT, II_LATENCY }
+#endif
 };
 
 // Input Items ---------
-const PROGMEM char listMidiMessage[]     = "Program Change| Control Code |  Note On/Off |  Pitch Bend  ";
+const PROGMEM char listMidiMessage[]     = "Program Change| Control Code |  Note On/Off |  Pitch Bend  |  CC 14-bit   | Bend 14-bit  |  CC Relative |     Macro    ";
 const PROGMEM char listPedalFunction[]   = "     MIDI     |    Bank +    |    Bank -    |     Start    |     Stop     |   Continue   |     Tap      |     Menu     |    Confirm   |    Escape    |     Next     |   Previous   ";
 const PROGMEM char listPedalMode[]       = "   Momentary  |     Latch    |    Analog    |   Jog Wheel  |  Momentary 2 |  Momentary 3 |    Latch 2   |    Ladder    ";
 const PROGMEM char listPedalPressMode[]  = "    Single    |    Double    |     Long     |      1+2     |      1+L     |     1+2+L    |      2+L     ";
 const PROGMEM char listPolarity[]        = " No|Yes";
-const PROGMEM char listResponseCurve[]   = "    Linear    |      Log     |   Anti-Log   ";
+const PROGMEM char listResponseCurve[]   = "    Linear    |      Log     |   Anti-Log   |    Custom    ";
 const PROGMEM char listInterface[]       = "     USB      |  Legacy MIDI |   AppleMIDI  |    ipMIDI    |   Bluetooth  |     OSC      ";
 const PROGMEM char listEnableDisable[]   = "   Disable    |    Enable    ";
 const PROGMEM char listMidiTimeCode[]    = "    None      |   MTC Slave  |    MTC 24    |    MTC 25    |   MTC 30 DF  |    MTC 30    |  Clock Slave | Clock Master ";
@@ -182,6 +206,11 @@ const PROGMEM MD_Menu::mnuInput_t mnuInp[] =
   { II_ZERO,          ">0-1023:  "  , MD_Menu::INP_INT,   mnuValueRqst,  4, 0, 0, ADC_RESOLUTION - 1, 0, 10, nullptr },
   { II_MAX,           ">0-1023:  "  , MD_Menu::INP_INT,   mnuValueRqst,  4, 0, 0, ADC_RESOLUTION - 1, 0, 10, nullptr },
   { II_RESPONSECURVE, ""            , MD_Menu::INP_LIST,  mnuValueRqst, 14, 0, 0,                  0, 0,  0, listResponseCurve },
+  { II_CURVE0,        ">0-255:    " , MD_Menu::INP_INT,   mnuValueRqst,  3, 0, 0,                255, 0, 10, nullptr },
+  { II_CURVE1,        ">0-255:    " , MD_Menu::INP_INT,   mnuValueRqst,  3, 0, 0,                255, 0, 10, nullptr },
+  { II_CURVE2,        ">0-255:    " , MD_Menu::INP_INT,   mnuValueRqst,  3, 0, 0,                255, 0, 10, nullptr },
+  { II_CURVE3,        ">0-255:    " , MD_Menu::INP_INT,   mnuValueRqst,  3, 0, 0,                255, 0, 10, nullptr },
+  { II_CURVE4,        ">0-255:    " , MD_Menu::INP_INT,   mnuValueRqst,  3, 0, 0,                255, 0, 10, nullptr },
   { II_INTERFACE,     ""            , MD_Menu::INP_LIST,  mnuValueRqst, 14, 0, 0,                  0, 0,  0, listInterface },
   { II_MIDI_IN,       ""            , MD_Menu::INP_LIST,  mnuValueRqst, 14, 0, 0,                  0, 0,  0, listEnableDisable },
   { II_MIDI_OUT,      ""            , MD_Menu::INP_LIST,  mnuValueRqst, 14, 0, 0,                  0, 0,  0, listEnableDisable },
@@ -198,7 +227,11 @@ const PROGMEM MD_Menu::mnuInput_t mnuInp[] =
   { II_BPM,           ">40-300:   " , MD_Menu::INP_INT,   mnuValueRqst,  3, 1, 0,                300, 40, 10, nullptr },
   { II_TIMESIGNATURE, ""            , MD_Menu::INP_LIST,  mnuValueRqst, 14, 0, 0,                  0, 0,  0, listTimeSignature },
   { II_SERIALPASS,    "Confirm"     , MD_Menu::INP_RUN,   mnuValueRqst,  0, 0, 0,                  0, 0,  0, nullptr },
-  { II_DEFAULT,       "Confirm"     , MD_Menu::INP_RUN,   mnuValueRqst,  0, 0, 0,                  0, 0,  0, nullptr }
+  { II_DEFAULT,       "Confirm"     , MD_Menu::INP_RUN,   mnuValueRqst,  0, 0, 0,                  0, 0,  0, nullptr },
+  { II_LATENCY,       "Show"        , MD_Menu::INP_RUN,   mnuValueRqst,  0, 0, 0,                  0, 0,  0, nullptr },
+  { II_SPECULATIVE,   ""            , MD_Menu::INP_LIST,  mnuValueRqst, 14, 0, 0,                  0, 0,  0, listEnableDisable },
+  { II_FILTER_CUTOFF, ">1-224:    " , MD_Menu::INP_INT,   mnuValueRqst,  3, 1, 0,                224, 0, 10, nullptr },
+  { II_FILTER_BETA,   ">0-224:    " , MD_Menu::INP_INT,   mnuValueRqst,  3, 0, 0,                224, 0, 10, nullptr }
 };
 
 // bring it all together in the global menu object
@@ -233,7 +266,7 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
 
     case II_BANK:
       if (bGet) vBuf.value = currentBank + 1;
-      else currentBank = vBuf.value - 1;
+      else bank_select(vBuf.value - 1);
       break;
 
     case II_PEDAL:
@@ -322,6 +355,14 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
       }
       break;
 
+    case II_SPECULATIVE:
+      if (bGet) vBuf.value = pedals[currentPedal].speculative;
+      else {
+        pedals[currentPedal].speculative = vBuf.value;
+        serialize_pedal();
+      }
+      break;
+
     case II_POLARITY:
       if (bGet) vBuf.value = pedals[currentPedal].invertPolarity;
       else {
@@ -332,6 +373,7 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
 
     case II_CALIBRATE:
       if (!bGet && pedals[currentPedal].mode == PED_ANALOG) calibrate();
+      if (!bGet && pedals[currentPedal].mode == PED_LADDER) calibrate_ladder();
       r = nullptr;
       break;
 
@@ -346,6 +388,19 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
       }
       break;
 
+    case II_FILTER_CUTOFF:
+    case II_FILTER_BETA:
+      if (bGet)
+        if (pedals[currentPedal].mode == PED_ANALOG)
+          vBuf.value = FILTER_TUNING((id == II_FILTER_CUTOFF) ? pedals[currentPedal].filterCutoff : pedals[currentPedal].filterBeta);
+        else r = nullptr;
+      else {
+        if (id == II_FILTER_CUTOFF) pedals[currentPedal].filterCutoff = max(filter_tuning_step(vBuf.value), 1);   // nearest step
+        else pedals[currentPedal].filterBeta = filter_tuning_step(vBuf.value);
+        serialize_pedal();
+      }
+      break;
+
     case II_MAX:
       if (bGet)
         if (pedals[currentPedal].mode == PED_ANALOG)
@@ -368,6 +423,19 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
       }
       break;
 
+    case II_CURVE0:
+    case II_CURVE1:
+    case II_CURVE2:
+    case II_CURVE3:
+    case II_CURVE4:
+      if (bGet)
+        if (pedals[currentPedal].mode == PED_ANALOG && pedals[currentPedal].mapFunction == PED_CUSTOM)
+          vBuf.value = pedals[currentPedal].curve[id - II_CURVE0];
+        else r = nullptr;
+      else
+        pedals[currentPedal].curve[id - II_CURVE0] = vBuf.value;
+      break;
+
     case II_INTERFACE:
       if (bGet) vBuf.value = currentInterface;
       else {
@@ -388,6 +456,7 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
       if (bGet) vBuf.value = interfaces[currentInterface].midiOut;
       else {
         interfaces[currentInterface].midiOut = vBuf.value;
+        midi_ports_setup();
         serialize_interface();
       }
       break;
@@ -407,6 +476,7 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
       if (bGet) vBuf.value = interfaces[currentInterface].midiRouting;
       else {
         interfaces[currentInterface].midiRouting = vBuf.value;
+        midi_ports_setup();
         serialize_interface();
       }
       break;
@@ -415,6 +485,7 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
       if (bGet) vBuf.value = interfaces[currentInterface].midiClock;
       else {
         interfaces[currentInterface].midiClock = vBuf.value;
+        midi_ports_setup();
         serialize_interface();
       }
       break;
@@ -591,14 +662,19 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
     case II_SERIALPASS:
       if (!bGet) {
         serialPassthrough = true;
-        Serial.end();
-        Serial3.end();
+        usbPort.end();
+        espPort.end();
         Serial.begin(115200);
         Serial3.begin(115200);
       }
       r = nullptr;
       break;
 
+    case II_LATENCY:
+      if (!bGet) latency_show();
+      r = nullptr;
+      break;
+
     case II_DEFAULT:
       if (!bGet) {
         lcd.clear();
@@ -616,7 +692,7 @@ MD_Menu::value_t *mnuValueRqst(MD_Menu::mnuId_t id, bool bGet)
       break;
   }
 
-  if (!bGet && id != II_PROFILE_LOAD && id != II_IRLEARN && id != II_WIFIRESET) {
+  if (!bGet && id != II_PROFILE_LOAD && id != II_IRLEARN && id != II_WIFIRESET && id != II_LATENCY) {
     update_eeprom();
     controller_setup();
   }
@@ -729,8 +805,8 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
     k = 0;
     k1 = MD_UISwitch::KEY_NULL;
     k2 = MD_UISwitch::KEY_NULL;
-    if (pedals[i].footSwitch[0] != nullptr) k1 = pedals[i].footSwitch[0]->read();
-    if (pedals[i].footSwitch[1] != nullptr) k2 = pedals[i].footSwitch[1]->read();
+    if (pool_switch(i, 0) != nullptr) k1 = pool_switch(i, 0)->read();
+    if (pool_switch(i, 1) != nullptr) k2 = pool_switch(i, 1)->read();
     if ((k1 == MD_UISwitch::KEY_PRESS || k1 == MD_UISwitch::KEY_DPRESS || k1 == MD_UISwitch::KEY_LONGPRESS) && k2 == MD_UISwitch::KEY_NULL) k = 1;
     if ((k2 == MD_UISwitch::KEY_PRESS || k2 == MD_UISwitch::KEY_DPRESS || k2 == MD_UISwitch::KEY_LONGPRESS) && k1 == MD_UISwitch::KEY_NULL) k = 2;
     if ((k1 == MD_UISwitch::KEY_PRESS || k1 == MD_UISwitch::KEY_DPRESS || k1 == MD_UISwitch::KEY_LONGPRESS) &&
@@ -739,7 +815,7 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
       // Single press
       if (pedals[i].mode == PED_LADDER) {
         if (k1 != MD_UISwitch::KEY_NULL) {
-          switch (pedals[i].footSwitch[0]->getKey()) {
+          switch (pool_switch(i, 0)->getKey()) {
 
             case 'S':
               return MD_Menu::NAV_SEL;
@@ -758,14 +834,14 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
             case 'U':
               if (M.isInMenu())
                 return MD_Menu::NAV_INC;
-              else if (currentBank < BANKS - 1) currentBank++;
+              else if (currentBank < BANKS - 1) bank_select(currentBank + 1);
               return MD_Menu::NAV_NULL;
               break;
 
             case 'D':
               if (M.isInMenu())
                 return MD_Menu::NAV_DEC;
-              else if (currentBank > 0) currentBank--;
+              else if (currentBank > 0) bank_select(currentBank - 1);
               return MD_Menu::NAV_NULL;
               break;
 
@@ -788,10 +864,10 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
         case PED_BANK_PLUS:
           switch (k) {
             case 1:
-              if (currentBank < BANKS - 1) currentBank++;
+              if (currentBank < BANKS - 1) bank_select(currentBank + 1);
               break;
             case 2:
-              if (currentBank > 0) currentBank--;
+              if (currentBank > 0) bank_select(currentBank - 1);
               break;
             case 3:
               break;
@@ -801,10 +877,10 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
         case PED_BANK_MINUS:
           switch (k) {
             case 1:
-              if (currentBank > 0) currentBank--;
+              if (currentBank > 0) bank_select(currentBank - 1);
               break;
             case 2:
-              if (currentBank < BANKS - 1) currentBank++;
+              if (currentBank < BANKS - 1) bank_select(currentBank + 1);
               break;
             case 3:
               break;
@@ -818,7 +894,7 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
               MTC.sendPlay();
               break;
             case 2:
-              bpm = MTC.tapTempo();
+              bpm = MTC.tapTempo(scanner_pressed(i));
               break;
             case 3:
               break;
@@ -832,7 +908,7 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
               MTC.sendStop();
               break;
             case 2:
-              bpm = MTC.tapTempo();
+              bpm = MTC.tapTempo(scanner_pressed(i));
               if (bpm > 0) MTC.setBpm(bpm);
               break;
             case 3:
@@ -846,7 +922,7 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
               MTC.sendContinue();
               break;
             case 2:
-              bpm = MTC.tapTempo();
+              bpm = MTC.tapTempo(scanner_pressed(i));
               break;
             case 3:
               break;
@@ -856,7 +932,7 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
         case PED_TAP:
           switch (k) {
             case 1:
-              bpm = MTC.tapTempo();
+              bpm = MTC.tapTempo(scanner_pressed(i));
               if (bpm > 0) MTC.setBpm(bpm);
               break;
             case 2:
@@ -896,21 +972,21 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
     }
 
     // Double press, long press and repeat
-    if (pedals[i].footSwitch[0] != nullptr)
+    if (pool_switch(i, 0) != nullptr)
       switch (k1) {
         case MD_UISwitch::KEY_NULL:
-          pedals[i].footSwitch[0]->setDoublePressTime(300);
-          pedals[i].footSwitch[0]->setLongPressTime(500);
-          pedals[i].footSwitch[0]->setRepeatTime(500);
-          pedals[i].footSwitch[0]->enableDoublePress(true);
-          pedals[i].footSwitch[0]->enableLongPress(true);
+          pool_switch(i, 0)->setDoublePressTime(300);
+          pool_switch(i, 0)->setLongPressTime(500);
+          pool_switch(i, 0)->setRepeatTime(500);
+          pool_switch(i, 0)->enableDoublePress(true);
+          pool_switch(i, 0)->enableLongPress(true);
           break;
         case MD_UISwitch::KEY_RPTPRESS:
-          pedals[i].footSwitch[0]->setDoublePressTime(0);
-          pedals[i].footSwitch[0]->setLongPressTime(0);
-          pedals[i].footSwitch[0]->setRepeatTime(10);
-          pedals[i].footSwitch[0]->enableDoublePress(false);
-          pedals[i].footSwitch[0]->enableLongPress(false);
+          pool_switch(i, 0)->setDoublePressTime(0);
+          pool_switch(i, 0)->setLongPressTime(0);
+          pool_switch(i, 0)->setRepeatTime(10);
+          pool_switch(i, 0)->enableDoublePress(false);
+          pool_switch(i, 0)->enableLongPress(false);
           break;
         case MD_UISwitch::KEY_DPRESS:
           if (pedals[i].function == PED_MENU) return MD_Menu::NAV_SEL;
@@ -922,21 +998,21 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
           break;
       }
 
-    if (pedals[i].footSwitch[1] != nullptr)
+    if (pool_switch(i, 1) != nullptr)
       switch (k2) {
         case MD_UISwitch::KEY_NULL:
-          pedals[i].footSwitch[1]->setDoublePressTime(300);
-          pedals[i].footSwitch[1]->setLongPressTime(500);
-          pedals[i].footSwitch[1]->setRepeatTime(500);
-          pedals[i].footSwitch[1]->enableDoublePress(true);
-          pedals[i].footSwitch[1]->enableLongPress(true);
+          pool_switch(i, 1)->setDoublePressTime(300);
+          pool_switch(i, 1)->setLongPressTime(500);
+          pool_switch(i, 1)->setRepeatTime(500);
+          pool_switch(i, 1)->enableDoublePress(true);
+          pool_switch(i, 1)->enableLongPress(true);
           break;
         case MD_UISwitch::KEY_RPTPRESS:
-          pedals[i].footSwitch[1]->setDoublePressTime(0);
-          pedals[i].footSwitch[1]->setLongPressTime(0);
-          pedals[i].footSwitch[1]->setRepeatTime(10);
-          pedals[i].footSwitch[1]->enableDoublePress(false);
-          pedals[i].footSwitch[1]->enableLongPress(false);
+          pool_switch(i, 1)->setDoublePressTime(0);
+          pool_switch(i, 1)->setLongPressTime(0);
+          pool_switch(i, 1)->setRepeatTime(10);
+          pool_switch(i, 1)->enableDoublePress(false);
+          pool_switch(i, 1)->enableLongPress(false);
           break;
         case MD_UISwitch::KEY_DPRESS:
           if (pedals[i].function == PED_MENU) return MD_Menu::NAV_SEL;
@@ -1061,7 +1137,7 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
     if (numberPressed != 0) {                                               // number pressed
       if (selectBank) {                                                     // select the bank
         if (numberPressed >= 1 && numberPressed <= BANKS) {
-          currentBank = numberPressed - 1;
+          bank_select(numberPressed - 1);
           update_eeprom();
           controller_setup();
         }
@@ -1072,8 +1148,8 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
                   banks[currentBank][lastUsedSwitch].midiCode,
                   banks[currentBank][lastUsedSwitch].midiValue1,
                   banks[currentBank][lastUsedSwitch].midiChannel);
-        pedals[lastUsedSwitch].pedalValue[0] = LOW;
-        pedals[lastUsedSwitch].lastUpdate[0] = millis();
+        pedalStates[lastUsedSwitch].pedalValue[0] = LOW;
+        pedal_touch(lastUsedSwitch, millis());
         screen_update();
         delay(10);
         midi_send(banks[currentBank][lastUsedSwitch].midiMessage,
@@ -1081,8 +1157,8 @@ MD_Menu::userNavAction_t navigation(uint16_t &incDelta)
                   banks[currentBank][lastUsedSwitch].midiValue2,
                   banks[currentBank][lastUsedSwitch].midiChannel,
                   pedals[lastUsedSwitch].mode == PED_LATCH1 || pedals[lastUsedSwitch].mode == PED_LATCH2);
-        pedals[lastUsedSwitch].pedalValue[0] = HIGH;
-        pedals[lastUsedSwitch].lastUpdate[0] = millis();
+        pedalStates[lastUsedSwitch].pedalValue[0] = HIGH;
+        pedal_touch(lastUsedSwitch, millis());
         screen_update();
       }
     }
@@ -0,0 +1,500 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+#ifndef _MIDIPORT_H
+#define _MIDIPORT_H
+
+//
+//  Non-blocking MIDI output ports
+//
+//  HardwareSerial::write() spins as soon as the 64 bytes UART buffer is full, so a burst to the
+//  31250 baud DIN port used to stall the messages to USB and ESP queued behind it. Each port has
+//  its own transmit ring in front of the UART buffer: write() returns at once, the ring is moved
+//  into the UART buffer (emptied by the data register empty interrupt) on every loop. The DIN
+//  ring, whose UART buffer lasts 20 ms, also gets a few bytes on every sampling tick so a slow
+//  loop (menu, EEPROM) does not starve it; USB and ESP are never moved by the interrupt, which
+//  stays short enough for the 1 Mbaud USB input. A message that does not fit is dropped whole
+//  and counted in overflows; real time bytes (clock, start, stop) wait in a few slots of their
+//  own that are moved first, so they go ahead of the messages still in the ring (not of the
+//  bytes already in the UART buffer), as MIDI allows. A buffer of whole messages (macros) is
+//  queued in one go or dropped whole.
+//
+//  SIZE is a power of two up to 128. SIZE 0 writes straight through to the port, for the
+//  SoftwareSerial ports of the UNO that have no transmit buffer to feed.
+//
+//  Single writer: the port is written from the sampling and clock interrupts, always with
+//  interrupts masked. A caller that writes the port directly (JSON to the ESP, latency reports,
+//  debug output, serial passthrough) holds it first: hold() drains the ring, then everything
+//  written to the port object stays queued (SIZE 0 drops it) until the matching resume().
+//
+//  Running status: on a port created with runningStatus, a channel status byte equal to the last
+//  one sent is left out, so a CC stream costs 2 bytes per value instead of 3. System Common and
+//  SysEx cancel it (the next channel message sends its status again), real time bytes do not.
+//  Anything written to the port directly while held cancels it as well.
+//
+//  Latest value wins: while coalesce is set (analog pedal streams), Control Change and Pitch
+//  Bend messages are updates of a state. One that finds the port behind, more than
+//  MIDI_PORT_BACKLOG bytes still to send, waits in a small table keyed by status and controller
+//  (status only for Pitch Bend) where a newer value overwrites it. The table goes out once the
+//  port has caught up, so a slow port skips the stale values and the backlog stays bounded.
+//  The LSB of a 14-bit Control Change (32-63) rides with its MSB: it is parked in the MSB entry,
+//  or sent at once when the MSB has just been, so the receiver never gets one half of a value
+//  with the other half of another. Any other channel message first sends the entries of its
+//  channel, so a note or a program change never overtakes a value sent before it.
+//
+//  Latency (LATENCY_PEDALINO): mark() flags the end of the message just queued, latency_uart()
+//  is called when its last byte is written into the UART buffer, at once if it went straight
+//  through. One mark per port, a newer message moves it.
+//
+
+#include <util/atomic.h>
+
+#ifdef LATENCY_PEDALINO
+void latency_uart();
+#endif
+
+#define MIDI_PORT_MESSAGE   3             // room to start a message: status and two data bytes
+#define MIDI_PORT_BURST     4             // DIN bytes moved per sampling tick (31250 baud = 3.1 bytes/ms)
+#define MIDI_PORT_UPDATES   8             // pending updates per port (distinct controllers)
+#define MIDI_PORT_BACKLOG   6             // bytes still to send above which updates wait (2 ms on DIN)
+#define MIDI_PORT_REALTIME  4             // real time bytes waiting ahead of the ring
+#define MIDI_PORT_NO_LSB    0x80          // midi_update without a 14-bit LSB
+
+struct midi_update {
+  byte                   status;          // 0 = free
+  byte                   data1;
+  byte                   data2;
+  byte                   lsb;             // LSB of a 14-bit Control Change parked with its MSB
+};
+
+template <class S, byte SIZE>
+class MidiPort : public Stream
+{
+  static_assert((SIZE & (SIZE - 1)) == 0 && SIZE <= 128, "MidiPort size must be a power of two up to 128");
+
+  public:
+    MidiPort(S &s, bool rs = false) : port(s), runningStatus(rs) {}
+    void    begin(unsigned long baud)     { port.begin(baud); capacity = port.availableForWrite(); }
+    void    end()                         { hold(); port.end(); }
+    int     available()                   { return port.available(); }
+    int     read()                        { return port.read(); }
+    int     peek()                        { return port.peek(); }
+    void    flush()                       { drain(); port.flush(); }
+    size_t  write(uint8_t b);
+    size_t  write(const uint8_t *buffer, size_t size);
+    using   Print::write;
+    byte    queued()                      { return (head - tail) & (SIZE - 1); }
+    void    pump(byte burst = 0xFF);
+    void    drain();
+    void    hold()                        { drain(); holds++; }
+    void    resume()                      { holds--; }
+#ifdef LATENCY_PEDALINO
+    void    mark();
+#endif
+
+    volatile unsigned int overflows = 0;  // messages dropped because the ring was full
+    bool                  coalesce  = false;
+
+  private:
+    size_t  put(uint8_t b);
+    byte    room();
+    void    update();
+    void    release();
+    void    release(byte channel);
+    void    send(midi_update &u);
+    int     backlog()                     { return queued() + realtimeQueued + capacity - port.availableForWrite(); }
+    bool    direct()                      { return holds == 0 && head == tail && realtimeQueued == 0; }
+
+    S               &port;
+    const bool       runningStatus;
+    byte             ring[SIZE ? SIZE : 1];
+    volatile byte    head     = 0;
+    volatile byte    tail     = 0;
+    byte             realtime[MIDI_PORT_REALTIME];
+    volatile byte    realtimeQueued = 0;
+    volatile byte    holds    = 0;        // the main loop writes the port directly, nothing else does
+    bool             dropping = false;    // the rest of the current message is dropped
+    byte             running  = 0;        // channel status the receiver is running on, 0 = none
+    byte             capacity = 0;        // UART buffer size, as free right after begin()
+    byte             message[MIDI_PORT_MESSAGE];
+    byte             assembled = 0;       // bytes of the update in message[]
+    midi_update      updates[SIZE ? MIDI_PORT_UPDATES : 1];
+    volatile byte    pending = 0;         // updates waiting in updates[]
+    byte             paired  = 0;         // status of the 14-bit MSB just sent at once, 0 = none
+    byte             pairedCode = 0;      // and its controller
+#ifdef LATENCY_PEDALINO
+    volatile byte    marked  = 0xFF;      // ring index after the last byte of the marked message, 0xFF = none
+#endif
+};
+
+//
+//  Queue one byte, never waits
+//
+template <class S, byte SIZE>
+size_t MidiPort<S, SIZE>::write(uint8_t b)
+{
+  if (SIZE == 0 || b >= 0xF8) return put(b);            // nothing to catch up with, or real time
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (coalesce && ((b & 0xF0) == 0xB0 || (b & 0xF0) == 0xE0)) {
+      for (byte i = 0; i < assembled; i++) put(message[i]);
+      message[0] = b;
+      assembled  = 1;
+      return 1;
+    }
+    if (assembled > 0 && b < 0x80) {
+      message[assembled++] = b;
+      if (assembled == MIDI_PORT_MESSAGE) {
+        assembled = 0;
+        update();
+      }
+      return 1;
+    }
+    for (byte i = 0; i < assembled; i++) put(message[i]);  // anything else ends the update
+    assembled = 0;
+    if (pending > 0 && b >= 0x80 && b < 0xF0) release(b & 0x0F);
+  }
+  return put(b);
+}
+
+//
+//  Latest value wins: overwrite the pending update of the same controller, or send it now if
+//  the port keeps up
+//
+template <class S, byte SIZE>
+void MidiPort<S, SIZE>::update()
+{
+  byte slot = MIDI_PORT_UPDATES;
+  bool cc   = ((message[0] & 0xF0) == 0xB0);
+  bool lsb  = (cc && message[1] >= 32 && message[1] < 64);
+  bool now;
+
+  for (byte i = 0; i < MIDI_PORT_UPDATES; i++) {
+    if (updates[i].status == 0) {
+      if (slot == MIDI_PORT_UPDATES) slot = i;
+    }
+    else if (updates[i].status == message[0]) {
+      if (lsb && updates[i].data1 == message[1] - 32) {
+        updates[i].lsb = message[2];                      // goes out right after its MSB
+        return;
+      }
+      if (!cc || updates[i].data1 == message[1]) {
+        updates[i].data1 = message[1];
+        updates[i].data2 = message[2];
+        updates[i].lsb   = MIDI_PORT_NO_LSB;              // the LSB of the old value is stale
+        return;
+      }
+    }
+  }
+  now = (pending == 0 && backlog() <= MIDI_PORT_BACKLOG) || slot == MIDI_PORT_UPDATES ||
+        (lsb && message[0] == paired && message[1] - 32 == pairedCode);
+  paired = 0;
+  if (now) {
+    for (byte i = 0; i < MIDI_PORT_MESSAGE; i++) put(message[i]);
+    if (cc && message[1] < 32) {
+      paired     = message[0];
+      pairedCode = message[1];
+    }
+    return;
+  }
+  updates[slot] = { message[0], message[1], message[2], MIDI_PORT_NO_LSB };
+  pending++;
+}
+
+//
+//  Send the pending updates once the port has caught up
+//
+template <class S, byte SIZE>
+void MidiPort<S, SIZE>::release()
+{
+  if (pending == 0 || backlog() > MIDI_PORT_BACKLOG) return;
+  for (byte i = 0; i < MIDI_PORT_UPDATES; i++)
+    if (updates[i].status != 0) send(updates[i]);
+}
+
+//
+//  Send the pending updates of a channel ahead of another message on it, ready or not
+//
+template <class S, byte SIZE>
+void MidiPort<S, SIZE>::release(byte channel)
+{
+  for (byte i = 0; i < MIDI_PORT_UPDATES; i++)
+    if (updates[i].status != 0 && (updates[i].status & 0x0F) == channel) send(updates[i]);
+}
+
+//
+//  One pending update out of the table, the 14-bit LSB right after its MSB
+//
+template <class S, byte SIZE>
+void MidiPort<S, SIZE>::send(midi_update &u)
+{
+  put(u.status);
+  put(u.data1);
+  put(u.data2);
+  if (u.lsb != MIDI_PORT_NO_LSB) {
+    put(u.status);
+    put(u.data1 + 32);
+    put(u.lsb);
+  }
+  u.status = 0;
+  pending--;
+}
+
+//
+//  Queue whole messages at once, never waits
+//
+template <class S, byte SIZE>
+size_t MidiPort<S, SIZE>::write(const uint8_t *buffer, size_t size)
+{
+  if (SIZE == 0) return Print::write(buffer, size);
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (!coalesce && size > room()) {
+      overflows++;
+      return 0;
+    }
+    for (size_t i = 0; i < size; i++) write(buffer[i]);
+  }
+  return size;
+}
+
+//
+//  Bytes that fit in the ring and in the UART buffer
+//
+template <class S, byte SIZE>
+byte MidiPort<S, SIZE>::room()
+{
+  if (SIZE == 0) return (holds > 0) ? 0 : MIDI_PORT_MESSAGE;  // SoftwareSerial waits instead
+  return SIZE - 1 - queued() + (direct() ? port.availableForWrite() : 0);
+}
+
+//
+//  Queue one byte of a whole message
+//
+template <class S, byte SIZE>
+size_t MidiPort<S, SIZE>::put(uint8_t b)
+{
+  byte left;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    left = room();
+    if (b >= 0xF8) {                                      // real time: a single byte anywhere
+      if (SIZE > 0 && !(direct() && port.availableForWrite() > 0)) {
+        if (realtimeQueued == MIDI_PORT_REALTIME) {
+          overflows++;
+          return 0;
+        }
+        realtime[realtimeQueued++] = b;                   // ahead of the ring
+        return 1;
+      }
+      if (left == 0) {
+        overflows++;
+        return 0;
+      }
+    }
+    else if (b & 0x80) {                                  // status: the message starts only if it fits
+      dropping = (left < MIDI_PORT_MESSAGE - (b == running));
+      if (dropping) {
+        overflows++;
+        return 0;
+      }
+      if (b == running) return 1;                         // the receiver is still running on it
+      running = (runningStatus && b < 0xF0) ? b : 0;
+    }
+    else if (dropping) return 0;
+    else if (left == 0) {                                 // data: a long SysEx ran out of room
+      dropping = true;
+      overflows++;
+      return 0;
+    }
+
+    if (SIZE == 0 || (direct() && port.availableForWrite() > 0))
+      port.write(b);
+    else {
+      ring[head] = b;
+      head = (head + 1) & (SIZE - 1);
+    }
+  }
+  return 1;
+}
+
+//
+//  Move up to burst queued bytes into the UART buffer without waiting for room, real time first
+//
+template <class S, byte SIZE>
+void MidiPort<S, SIZE>::pump(byte burst)
+{
+  if (SIZE == 0 || holds > 0) return;
+
+  for (; burst > 0 && realtimeQueued > 0; burst--) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (port.availableForWrite() == 0) return;
+      port.write(realtime[0]);
+      realtimeQueued--;
+      for (byte i = 0; i < realtimeQueued; i++) realtime[i] = realtime[i + 1];
+    }
+  }
+  while (burst-- > 0 && head != tail) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      if (port.availableForWrite() == 0) return;
+      port.write(ring[tail]);
+      tail = (tail + 1) & (SIZE - 1);
+#ifdef LATENCY_PEDALINO
+      if (tail == marked) {
+        marked = 0xFF;
+        latency_uart();
+      }
+#endif
+    }
+  }
+  if (pending > 0) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      release();
+    }
+  }
+}
+
+#ifdef LATENCY_PEDALINO
+//
+//  Mark the last byte queued, the message is already in the UART buffer if the ring is empty
+//
+template <class S, byte SIZE>
+void MidiPort<S, SIZE>::mark()
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (head == tail) {
+      marked = 0xFF;
+      latency_uart();
+    }
+    else marked = head;
+  }
+}
+#endif
+
+//
+//  Wait until the ring is empty (configuration and reports, never the MIDI path), a held port
+//  keeps its queue until resume()
+//
+template <class S, byte SIZE>
+void MidiPort<S, SIZE>::drain()
+{
+  if (holds > 0) return;
+  while (head != tail || realtimeQueued > 0 || pending > 0) pump();
+  running = 0;
+}
+
+//
+//  Ports: rings sized on the port speed, DIN drains 3 bytes/ms, ESP 11.5 bytes/ms, USB 100 bytes/ms
+//
+#ifdef ARDUINO_MEGA
+typedef MidiPort<HardwareSerial, 64>  usb_port;
+typedef MidiPort<HardwareSerial, 128> din_port;
+typedef MidiPort<HardwareSerial, 128> esp_port;
+#else
+typedef MidiPort<HardwareSerial, 32>  usb_port;
+typedef MidiPort<SoftwareSerial, 0>   din_port;
+typedef MidiPort<SoftwareSerial, 0>   esp_port;
+#endif
+
+usb_port  usbPort(Serial);
+din_port  dinPort(Serial2, true);       // running status on the serial links only,
+esp_port  espPort(Serial3, true);       // the USB bridge on the host may not decode it
+
+void midi_ports_pump(byte burst = 0xFF)
+{
+  usbPort.pump(burst);
+  dinPort.pump(burst);
+  espPort.pump(burst);
+}
+
+void midi_ports_coalesce(bool on)
+{
+  usbPort.coalesce = on;
+  dinPort.coalesce = on;
+  espPort.coalesce = on;
+}
+
+//
+//  Fan-out
+//
+//  The ports enabled in interfaces[] are kept as bit masks: the pedals output, the clock and,
+//  for each port, the ports its input is forwarded to. midi_ports_setup() recomputes them when
+//  interfaces[] changes (EEPROM load, menu, Blynk), so a message only walks the bits set.
+//  Every interface behind the ESP (RTP-MIDI, ipMIDI, BLE, OSC) is the ESP port.
+//
+#define MIDI_PORT_USB       0
+#define MIDI_PORT_DIN       1
+#define MIDI_PORT_ESP       2
+#define MIDI_PORTS          3
+
+Print        *midiPorts[MIDI_PORTS] = { &usbPort, &dinPort, &espPort };
+byte          midiOutPorts    = 0;                // ports the pedals send to
+byte          midiClockPorts  = 0;                // ports the MIDI clock and MTC go to
+byte          midiRoutePorts[MIDI_PORTS];         // ports the input of each port is forwarded to
+
+void midi_ports_setup()
+{
+  byte out     = 0;
+  byte routing = 0;
+  byte port;
+
+  for (byte i = 0; i < INTERFACES; i++) {
+    port = (i == PED_USBMIDI) ? MIDI_PORT_USB : (i == PED_DINMIDI) ? MIDI_PORT_DIN : MIDI_PORT_ESP;
+    if (interfaces[i].midiOut)     out     |= bit(port);
+    if (interfaces[i].midiRouting) routing |= bit(port);
+  }
+  midiOutPorts   = out;
+  midiClockPorts = (interfaces[PED_USBMIDI].midiClock ? bit(MIDI_PORT_USB) : 0) |
+                   (interfaces[PED_DINMIDI].midiClock ? bit(MIDI_PORT_DIN) : 0) |
+                   (interfaces[PED_RTPMIDI].midiClock || interfaces[PED_IPMIDI].midiClock ? bit(MIDI_PORT_ESP) : 0);
+  for (port = 0; port < MIDI_PORTS; port++)
+    midiRoutePorts[port] = routing & ~bit(port);
+#ifdef DEBUG_PEDALINO
+  midiOutPorts   &= ~bit(MIDI_PORT_USB);          // the debug output owns Serial (usbPort is held)
+  midiClockPorts &= ~bit(MIDI_PORT_USB);
+  for (port = 0; port < MIDI_PORTS; port++)
+    midiRoutePorts[port] &= ~bit(MIDI_PORT_USB);
+#endif
+}
+
+//
+//  Raw bytes to the ports in the mask
+//
+void midi_ports_send(byte ports, const byte *message, unsigned int size)
+{
+  for (byte port = 0; ports != 0; port++, ports >>= 1)
+    if (ports & 1) midiPorts[port]->write(message, size);
+}
+
+//
+//  A message up to 3 bytes, its size from the status byte
+//
+void midi_ports_send(byte ports, byte status, byte data1 = 0, byte data2 = 0)
+{
+  byte message[] = { status, (byte)(data1 & 0x7F), (byte)(data2 & 0x7F) };
+  byte size;
+
+  switch (status & 0xF0) {
+    case midi::ProgramChange:
+    case midi::AfterTouchChannel:
+      size = 2;
+      break;
+    case 0xF0:
+      size = (status == midi::TimeCodeQuarterFrame || status == midi::SongSelect) ? 2 :
+             (status == midi::SongPosition) ? 3 : 1;
+      break;
+    default:
+      size = 3;
+      break;
+  }
+  midi_ports_send(ports, message, size);
+}
+
+#endif  // _MIDIPORT_H
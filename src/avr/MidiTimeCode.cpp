@@ -40,7 +40,12 @@ void TapTempo::reset()
 
 float TapTempo::tap()
 {
-  const unsigned long currentTime = millis();
+  return tap(millis());
+}
+
+// Tap at a given millis(), the time of the event rather than the time it is handled
+float TapTempo::tap(unsigned long currentTime)
+{
   if ( mLastTap > 0 )
   {
     if ( timeout(currentTime) )
@@ -420,19 +425,24 @@ void MidiTimeCode::setBpm(const float iBpm)
 }
 
 const float MidiTimeCode::tapTempo()
+{
+  return tapTempo(millis());
+}
+
+const float MidiTimeCode::tapTempo(unsigned long time)
 {
   static float bpm = 0.0f;
 
   switch (mMode) {
 
     case SynchroClockMaster:
-      return mTapTempo.tap();
+      return mTapTempo.tap(time);
 
     case SynchroClockSlave:
       mClick = (mClick + 1) % MidiTimeCode::mMidiClockPpqn;
       if (mClick == 0) {
         mBeat = (mBeat + 1) % mTimeSignature;
-        bpm = mTapTempo.tap();
+        bpm = mTapTempo.tap(time);
       }
       return bpm;
 
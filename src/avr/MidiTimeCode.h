@@ -29,6 +29,7 @@ class TapTempo
     ~TapTempo();
 
     float         tap();
+    float         tap(unsigned long currentTime);
     void          reset();
 
   private:
@@ -63,6 +64,7 @@ class MidiTimeCode
     // Only active in Midi Clock mode
     void        setBpm(const float iBpm);
     const float tapTempo();
+    const float tapTempo(unsigned long time);
     byte        getBeat();
     void        setBeat(byte signature);
     //
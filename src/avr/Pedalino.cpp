@@ -10,12 +10,26 @@
 
 #include "Pedalino.h"
 #include "Serialize.h"
+#include "JogWheel.h"
+#include "Scanner.h"
+#include "Latency.h"
+#include "ResponseCurves.h"
+#include "AnalogScanner.h"
+#include "Calibration.h"
+#include "Filter.h"
+#include "Ladder.h"
+#include "Chords.h"
+#include "Macros.h"
+#include "Pool.h"
 #include "Controller.h"
 #include "BlynkRPC.h"
 #include "Config.h"
 #include "MIDIRouting.h"
 #include "Display.h"
 #include "Menu.h"
+#ifdef _SIMULATOR_H
+#include "../sim/Bench.h"
+#endif
 
 void serial_pass_run()
 {
@@ -28,6 +42,8 @@ void serial_pass_run()
     lcd.setCursor(0, 1);
     lcd.print(" Reset to stop ");
 #endif
+    usbPort.hold();                 // nothing else writes the two ports from now on
+    espPort.hold();
     startSerialPassthrough = false;
   }
 
@@ -46,6 +62,7 @@ void setup(void)
 {
 #ifdef DEBUG_PEDALINO
   SERIALDEBUG.begin(115200);
+  usbPort.hold();                   // the debug output owns Serial
 
   DPRINTLNF("");
   DPRINTLNF("  __________           .___      .__  .__                   ___ ________________    ___");
@@ -106,6 +123,7 @@ void setup(void)
 
   autosensing_setup();
   controller_setup();
+  latency_reset();
   mtc_setup();
   midi_routing_start();
   blynk_config();
@@ -126,6 +144,10 @@ void loop(void)
 
     // Check whether the input has changed since last time, if so, send the new value over MIDI
     midi_refresh();
+    midi_ports_pump();
+    autosensing_run();
+    pedal_age();
+    update_learned_eeprom();
     midi_routing();
   }
 }
\ No newline at end of file
@@ -13,12 +13,19 @@
 #define _PEDALINO_H
 
 #define INTERFACES        6
-#define PROFILES          3
 
+//  Timers: Timer0 is millis()/micros() and Timer1 is the MIDI time code on every board. The
+//  switch scanner interrupt takes Timer3 on the MEGA and Timer2 on the UNO, where there is no
+//  other free timer: tone() and the IRremote receiver, which both use Timer2 on the UNO, must
+//  not be used in that build (NOLCD already leaves the IR remote out).
 #if defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__)     // Arduino UNO, NANO
 #define ARDUINO_UNO
+#define PROFILES          1           // no menu nor Blynk to switch profile, and 1 KB of EEPROM
 #define BANKS             5
 #define PEDALS            8
+#define LADDERS           1
+#define CHORDS            2
+#define MACROS            2
 #define PIN_D(x)          2+x         // map 0..7 to 2..9
 #define PIN_A(x)          PIN_A0+x    // map 0..7 to A0..A7
 #define NOLCD
@@ -26,8 +33,12 @@
 #undef  DEBUG_PEDALINO
 #elif defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)  // Arduino MEGA, MEGA2560
 #define ARDUINO_MEGA
+#define PROFILES          3
 #define BANKS             10
 #define PEDALS            16
+#define LADDERS           4           // in the shared EEPROM block, once for all the profiles
+#define CHORDS            8
+#define MACROS            4
 #define PIN_D(x)          23+2*x      // map 0..15 to 23,25,...53
 #define PIN_A(x)          PIN_A0+x    // map 0..15 to A0, A1,...A15
 #endif
@@ -51,7 +62,6 @@
 
 #include <EEPROM.h>                     // https://www.arduino.cc/en/Reference/EEPROM
 #include <MIDI.h>                       // https://github.com/FortySevenEffects/arduino_midi_library
-#include <ResponsiveAnalogRead.h>       // https://github.com/dxinteractive/ResponsiveAnalogRead
 #include <MD_UISwitch.h>                // https://github.com/MajicDesigns/MD_UISwitch
 
 #ifndef NOLCD
@@ -69,6 +79,10 @@
 #define PED_CONTROL_CHANGE  1
 #define PED_NOTE_ON_OFF     2
 #define PED_PITCH_BEND      3
+#define PED_CONTROL_CHANGE_14BIT    4
+#define PED_PITCH_BEND_14BIT        5
+#define PED_CONTROL_CHANGE_RELATIVE 6
+#define PED_MACRO                   7
 
 #define PED_MOMENTARY1      0
 #define PED_LATCH1          1
@@ -103,6 +117,7 @@
 #define PED_LINEAR          0
 #define PED_LOG             1
 #define PED_ANTILOG         2
+#define PED_CUSTOM          3
 
 #define PED_USBMIDI         0
 #define PED_DINMIDI         1
@@ -136,14 +151,25 @@
 #define PED_TIMESIGNATURE_12_8  6
 
 #define MIDI_RESOLUTION         128       // MIDI 7-bit CC resolution
+#define MIDI_RESOLUTION_14BIT 16384       // MIDI 14-bit CC and pitch bend resolution
 #define ADC_RESOLUTION         1024       // 10-bit ADC converter resolution
 #define CALIBRATION_DURATION   8000       // milliseconds
+#define LADDER_LEARN_TIMEOUT   5000       // milliseconds without a new button to end the ladder calibration
+#define LADDER_LEARN_HOLD       500       // milliseconds a button is read during the ladder calibration
+#define CURVE_USER_POINTS         5       // breakpoints of the user-defined response curve
+#define LADDER_KEYS              12       // max buttons of a resistor ladder
+#define CHORD_MESSAGES            3       // max messages of a chord
+#define MACRO_MESSAGES            4       // max messages of a macro
 
 struct bank {
   byte                   midiMessage;     /* 0 = Program Change,
                                              1 = Control Code
                                              2 = Note On/Note Off
-                                             3 = Pitch Bend */
+                                             3 = Pitch Bend
+                                             4 = Control Code 14-bit (MSB on code, LSB on code + 32)
+                                             5 = Pitch Bend 14-bit
+                                             6 = Control Code Relative (64 +/- steps)
+                                             7 = Macro (value 1-MACROS, 0 = nothing) */
   byte                   midiChannel;     /* MIDI channel 1-16 */
   byte                   midiCode;        /* Program Change, Control Code, Note or Pitch Bend value to send */
   byte                   midiValue1;      /* Single click */
@@ -151,41 +177,95 @@ struct bank {
   byte                   midiValue3;      /* Long click */
 };
 
+//
+//  Pedals Setup (read-mostly, bit-packed in 16-bit words) and runtime state (pedalStates[])
+//
 struct pedal {
-  byte                   function;        /* 0 = MIDI
-                                             1 = bank+
-                                             2 = bank-
-                                             3 = menu
-                                             4 = confirm
-                                             5 = escape
-                                             6 = next
-                                             7 = previous */
-  byte                   autoSensing;     /* 0 = disable
-                                             1 = enable   */
-  byte                   mode;            /* 0 = momentary
-                                             1 = latch
-                                             2 = analog
-                                             3 = jog wheel
-                                             4 = momentary 2
-                                             5 = momentary 3
-                                             6 = latch 2
-                                             7 = ladder */
-  byte                   pressMode;       /* 0 = single click
-                                             1 = double click
-                                             2 = long click
-                                             3 = single and double click
-                                             4 = single and long click
-                                             5 = single, double and long click
-                                             6 = double and long click */
-  byte                   invertPolarity;
-  byte                   mapFunction;
-  int                    expZero;
-  int                    expMax;
+  unsigned int           function       : 4;  /* 0 = MIDI
+                                                 1 = bank+
+                                                 2 = bank-
+                                                 3 = start
+                                                 4 = stop
+                                                 5 = continue
+                                                 6 = tap
+                                                 7 = menu
+                                                 8 = confirm
+                                                 9 = escape
+                                                10 = next
+                                                11 = previous */
+  unsigned int           autoSensing    : 1;  /* 0 = disable
+                                                 1 = enable   */
+  unsigned int           mode           : 3;  /* 0 = momentary
+                                                 1 = latch
+                                                 2 = analog
+                                                 3 = jog wheel
+                                                 4 = momentary 2
+                                                 5 = momentary 3
+                                                 6 = latch 2
+                                                 7 = ladder */
+  unsigned int           pressMode      : 3;  /* 0 = single click
+                                                 1 = double click
+                                                 2 = long click
+                                                 3 = single and double click
+                                                 4 = single and long click
+                                                 5 = single, double and long click
+                                                 6 = double and long click */
+  unsigned int           bounceTime     : 5;  // longest contact bounce learned (ms)
+  unsigned int           expZero        : 10;
+  unsigned int           speculative    : 1;  /* 0 = single click sent when the gesture is resolved
+                                                 1 = single click sent on press, double and long click follow */
+  unsigned int           invertPolarity : 1;
+  unsigned int           filterCutoff   : 4;  // smoothing cutoff at rest, step of filterTuning[]
+  unsigned int           expMax         : 10;
+  unsigned int           mapFunction    : 2;  /* 0 = linear
+                                                 1 = log
+                                                 2 = anti-log
+                                                 3 = custom */
+  unsigned int           filterBeta     : 4;  // smoothing cutoff increase per full travel per second, step of filterTuning[]
+  byte                   curve[CURVE_USER_POINTS];  // user-defined response curve (0-255 at 0, 25, 50, 75 and 100%)
+};
+
+// Analog filter tuning steps (0.1 Hz), about sqrt(2) apart
+#define FILTER_TUNING_STEPS     16
+#define FILTER_TUNING(step)     pgm_read_byte(&filterTuning[step])
+
+const PROGMEM byte filterTuning[FILTER_TUNING_STEPS] = {0, 1, 2, 3, 5, 7, 10, 14, 20, 28, 40, 56, 80, 112, 160, 224};
+
+struct pedal_state {
   int                    pedalValue[2];
-  unsigned long          lastUpdate[2];         // last time the value is changed
-  Bounce                *debouncer[2];
-  MD_UISwitch           *footSwitch[2];
-  ResponsiveAnalogRead  *analogPedal;
+  uint16_t               lastUpdate;            // millis() of the last change, low 16 bits (see pedal_elapsed())
+};
+
+struct ladder {
+  byte                   pedal;                       // pedal using the layout, 0xFF = free
+  byte                   keys;                        // number of buttons learned
+  uint16_t               threshold[LADDER_KEYS];      // ADC value of each button
+  byte                   tolerance[LADDER_KEYS];      // max distance from the threshold
+};
+
+struct chord_message {
+  byte                   midiMessage : 3; // same as bank
+  byte                   midiChannel : 5; // MIDI channel 1-16
+  byte                   midiCode;
+  byte                   midiValue;
+};
+
+struct chord {
+  uint16_t               pedals;                      // pedals pressed together (bit mask)
+  byte                   messages;                    // messages to send, 0 = chord disabled
+  chord_message          message[CHORD_MESSAGES];
+};
+
+struct macro_message {
+  byte                   midiMessage : 3; // same as bank, Macro excluded
+  byte                   midiChannel : 5; // MIDI channel 1-16
+  byte                   midiCode;
+  byte                   midiValue;
+};
+
+struct macro {
+  byte                   messages;                    // messages to send, 0 = macro disabled
+  macro_message          message[MACRO_MESSAGES];
 };
 
 struct interface {
@@ -196,9 +276,13 @@ struct interface {
   byte                   midiClock;       // 0 = disable, 1 = enable
 };
 
-bank      banks[BANKS][PEDALS];     // Banks Setup
-pedal     pedals[PEDALS];           // Pedals Setup
-interface interfaces[INTERFACES];   // Interfaces Setup
+bank        banks[BANKS][PEDALS];     // Banks Setup
+pedal       pedals[PEDALS];           // Pedals Setup
+pedal_state pedalStates[PEDALS];      // Pedals runtime state
+ladder      ladders[LADDERS];         // Resistor ladder layouts
+chord       chords[CHORDS];           // Chords Setup
+macro       macros[MACROS];           // Macros Setup
+interface   interfaces[INTERFACES];   // Interfaces Setup
 
 byte  currentProfile          = 0;
 byte  currentBank             = 0;
@@ -243,9 +327,11 @@ struct ESPSerialMIDISettings : public midi::DefaultSettings
   static const long BaudRate = 115200;
 };
 
-MIDI_CREATE_CUSTOM_INSTANCE(HardwareSerial, Serial,  USB_MIDI, USBSerialMIDISettings);
-MIDI_CREATE_INSTANCE(HardwareSerial, Serial2, DIN_MIDI);
-MIDI_CREATE_CUSTOM_INSTANCE(HardwareSerial, Serial3, ESP_MIDI, ESPSerialMIDISettings);
+#include "MidiPort.h"
+
+MIDI_CREATE_CUSTOM_INSTANCE(usb_port, usbPort, USB_MIDI, USBSerialMIDISettings);
+MIDI_CREATE_INSTANCE(din_port, dinPort, DIN_MIDI);
+MIDI_CREATE_CUSTOM_INSTANCE(esp_port, espPort, ESP_MIDI, ESPSerialMIDISettings);
 
 bool serialPassthrough = false;   // Serial passthrough between Serial and Serial3 to upload firmware on ESP01
 
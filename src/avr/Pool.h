@@ -0,0 +1,170 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Static pool of the per-pedal input objects
+//
+//  Each pedal owns one slot for each input object it may need (two UI switches and one
+//  analog filter). Objects are constructed in place in their slot and destroyed in place
+//  when the pedal is reconfigured, so the heap is never used and SRAM usage is the same
+//  no matter how many times the setup is edited. The slot of an object is implied by the
+//  pedal, so a bit per pedal tells whether it is constructed and no pointer is kept.
+//
+
+#define POOL_MAX(a, b)      ((a) > (b) ? (a) : (b))
+#define POOL_SWITCH_SIZE    POOL_MAX(sizeof(MD_UISwitch_Digital), sizeof(LadderSwitch))
+#define POOL_ANALOG_SIZE    sizeof(filter)
+
+struct pool_slot {
+  void                  *p;
+};
+
+inline void *operator new(size_t size, pool_slot slot) { return slot.p; }
+
+#if PEDALS <= 8
+typedef uint8_t   pool_mask;                              // a bit per pedal
+#else
+typedef uint16_t  pool_mask;
+#endif
+
+byte          poolSwitch[PEDALS][2][POOL_SWITCH_SIZE];    // footSwitch 0 and 1 of each pedal
+byte          poolAnalog[PEDALS][POOL_ANALOG_SIZE];       // analog filter of each pedal
+pool_mask     poolSwitchUsed[2]   = {0, 0};               // footSwitch n constructed (bit mask of pedals)
+pool_mask     poolLadderUsed      = 0;                    // footSwitch 0 is a LadderSwitch
+pool_mask     poolAnalogUsed      = 0;                    // analog filter constructed
+
+//
+//  Input objects of a pedal, nullptr if not constructed
+//
+MD_UISwitch *pool_switch(byte p, byte n)
+{
+  if (!(poolSwitchUsed[n] & (1U << p))) return nullptr;
+  if (n == 0 && (poolLadderUsed & (1U << p))) return (LadderSwitch *)poolSwitch[p][0];
+  return (MD_UISwitch_Digital *)poolSwitch[p][n];
+}
+
+filter *pool_analog(byte p)
+{
+  return (poolAnalogUsed & (1U << p)) ? (filter *)poolAnalog[p] : nullptr;
+}
+
+//
+//  Destroy all the input objects of a pedal
+//
+void pool_release(byte p)
+{
+  for (byte n = 0; n < 2; n++)
+    if (pool_switch(p, n) != nullptr) {
+      pool_switch(p, n)->~MD_UISwitch();
+      poolSwitchUsed[n] &= ~(1U << p);
+    }
+  poolLadderUsed &= ~(1U << p);
+  poolAnalogUsed &= ~(1U << p);
+}
+
+//
+//  Construct the input objects of a pedal in its own slots
+//
+MD_UISwitch *pool_new_digital(byte p, byte n, uint8_t pin, uint8_t onState)
+{
+  poolSwitchUsed[n] |= (1U << p);
+  return new (pool_slot{poolSwitch[p][n]}) MD_UISwitch_Digital(pin, onState);
+}
+
+MD_UISwitch *pool_new_ladder(byte p, uint8_t pin, byte decoder)
+{
+  poolSwitchUsed[0] |= (1U << p);
+  poolLadderUsed    |= (1U << p);
+  return new (pool_slot{poolSwitch[p][0]}) LadderSwitch(pin, decoder);
+}
+
+filter *pool_new_analog(byte p)
+{
+  poolAnalogUsed |= (1U << p);
+  return new (pool_slot{poolAnalog[p]}) filter();
+}
+
+//
+//  Pedal runtime state
+//
+//  pedalStates[] keeps 16-bit timestamps: pedal_elapsed() is exact up to PEDAL_AGE_LIMIT ms
+//  and pedal_age() moves older timestamps forward now and then, so an idle pedal never looks
+//  recently used when millis() wraps around the 16 bits.
+//
+#define PEDAL_AGE_LIMIT     30000                           // ms
+#define PEDAL_AGE_PERIOD    10000                           // ms
+
+void pedal_touch(byte p, unsigned long time)
+{
+  pedalStates[p].lastUpdate = time;
+}
+
+uint16_t pedal_elapsed(byte p)
+{
+  return (uint16_t)millis() - pedalStates[p].lastUpdate;
+}
+
+void pedal_age()
+{
+  static uint16_t last = 0;
+  uint16_t        now  = millis();
+
+  if ((uint16_t)(now - last) < PEDAL_AGE_PERIOD) return;
+  last = now;
+  for (byte p = 0; p < PEDALS; p++)
+    if (pedal_elapsed(p) > PEDAL_AGE_LIMIT) pedalStates[p].lastUpdate = now - PEDAL_AGE_LIMIT;
+}
+
+//
+//  SRAM of the pedal setup, the runtime state and the pool masks
+//
+#define PEDAL_TABLES_SIZE   (sizeof(pedals) + sizeof(pedalStates) + sizeof(poolSwitchUsed) + sizeof(poolLadderUsed) + sizeof(poolAnalogUsed))
+
+//
+//  Free SRAM between heap and stack
+//
+int free_memory()
+{
+  extern char   __heap_start;
+  extern char  *__brkval;
+  char          top;
+
+  return &top - (__brkval == nullptr ? &__heap_start : __brkval);
+}
+
+//
+//  Print pool usage and free SRAM
+//
+void pool_report()
+{
+  byte switches = 0;
+  byte analogs  = 0;
+
+  for (byte p = 0; p < PEDALS; p++) {
+    if (pool_switch(p, 0) != nullptr) switches++;
+    if (pool_switch(p, 1) != nullptr) switches++;
+    if (pool_analog(p)    != nullptr) analogs++;
+  }
+
+  DPRINTF("Input objects      ");
+  DPRINT(switches * POOL_SWITCH_SIZE + analogs * POOL_ANALOG_SIZE);
+  DPRINTF("/");
+  DPRINT(sizeof(poolSwitch) + sizeof(poolAnalog));
+  DPRINTF(" bytes in use (");
+  DPRINT(switches);
+  DPRINTF(" switches, ");
+  DPRINT(analogs);
+  DPRINTF(" analog)   Free SRAM ");
+  DPRINT(free_memory());
+  DPRINTLNF(" bytes");
+  DPRINTF("Pedal tables       ");
+  DPRINT(PEDAL_TABLES_SIZE);
+  DPRINTLNF(" bytes");
+}
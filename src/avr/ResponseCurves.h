@@ -0,0 +1,93 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Response curves
+//
+//  Curves map the calibrated pedal position to the output value, both in MIDI 14-bit
+//  resolution [0, CURVE_RESOLUTION - 1].
+//  Log and anti-log curves are precomputed in flash (10-bit values) at CURVE_POINTS evenly
+//  spaced inputs, plus 32 more points in the first (steepest) segment of the log curve, and
+//  the user-defined curve of each pedal is made of CURVE_USER_POINTS 8-bit breakpoints
+//  (0, 25, 50, 75 and 100%) stored in EEPROM.
+//  Values between two points are linearly interpolated with integer math only, unless
+//  CURVE_NO_INTERPOLATION is defined (nearest lower point).
+//
+
+#define CURVE_BITS          14
+#define CURVE_RESOLUTION    (1 << CURVE_BITS)
+#define CURVE_POINTS        33                                  // flash table size (32 segments)
+#define CURVE_SEGMENT_BITS  (CURVE_BITS - 5)                    // inputs per flash table segment
+#define CURVE_HEAD_BITS     (CURVE_SEGMENT_BITS - 5)            // inputs per head table segment
+#define CURVE_TABLE_SHIFT   (CURVE_BITS - 10)                   // flash tables are 10-bit
+#define CURVE_USER_BITS     (CURVE_BITS - 2)                    // inputs per user curve segment
+#define CURVE_USER_SHIFT    (CURVE_BITS - 8)                    // user breakpoints are 8-bit
+
+// y=log(x+1)/log(1023)*1023
+const PROGMEM uint16_t curveLog[CURVE_POINTS] = {
+     0,  516,  616,  675,  717,  750,  777,  799,  819,  836,  852,  866,  879,  891,  901,  912,
+   921,  930,  938,  946,  954,  961,  968,  975,  981,  987,  993,  998, 1004, 1009, 1014, 1019,
+  1023 };
+
+const PROGMEM uint16_t curveLogHead[CURVE_POINTS - 1] = {
+     0,  102,  162,  205,  238,  264,  287,  307,  324,  340,  354,  367,  379,  390,  400,  409,
+   418,  427,  435,  442,  449,  456,  463,  469,  475,  481,  486,  492,  497,  502,  507,  512 };
+
+// y=[e^(2*x/1023)-1]/[e^2-1]*1023
+const PROGMEM uint16_t curveAntiLog[CURVE_POINTS] = {
+     0,   10,   21,   33,   46,   59,   73,   88,  104,  121,  139,  159,  179,  201,  224,  249,
+   276,  304,  334,  366,  399,  436,  474,  515,  559,  605,  654,  707,  763,  822,  886,  953,
+  1023 };
+
+//
+//  Map a [0, CURVE_RESOLUTION - 1] value through a flash table (and its optional first segment table)
+//
+unsigned int curve_lookup(const uint16_t *table, unsigned int value, const uint16_t *head = nullptr)
+{
+  byte          bits = CURVE_SEGMENT_BITS;
+  byte          i;
+  unsigned int  y0, y1;
+
+  if (head && (value >> CURVE_SEGMENT_BITS) == 0) {
+    bits = CURVE_HEAD_BITS;
+    i    = value >> bits;
+    y0   = pgm_read_word(&head[i]);
+    y1   = (i < CURVE_POINTS - 2) ? pgm_read_word(&head[i + 1]) : pgm_read_word(&table[1]);
+  }
+  else {
+    i    = value >> bits;
+    y0   = pgm_read_word(&table[i]);
+    y1   = pgm_read_word(&table[i + 1]);
+  }
+#ifdef CURVE_NO_INTERPOLATION
+  return y0 << CURVE_TABLE_SHIFT;
+#else
+  unsigned int  f = value & ((1 << bits) - 1);
+
+  // flash tables are increasing and (y1 - y0) * f < 2^16
+  return (y0 << CURVE_TABLE_SHIFT) + (((y1 - y0) * f) >> (bits - CURVE_TABLE_SHIFT));
+#endif
+}
+
+//
+//  Map a [0, CURVE_RESOLUTION - 1] value through user-defined breakpoints [0, 255]
+//
+unsigned int curve_user(const byte *points, unsigned int value)
+{
+  byte          i  = value >> CURVE_USER_BITS;
+  unsigned int  y0 = points[i] << CURVE_USER_SHIFT;
+#ifdef CURVE_NO_INTERPOLATION
+  return y0;
+#else
+  unsigned int  f  = value & ((1 << CURVE_USER_BITS) - 1);
+
+  return y0 + (((long)(points[i + 1] - points[i]) * f) >> (CURVE_USER_BITS - CURVE_USER_SHIFT));
+#endif
+}
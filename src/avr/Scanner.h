@@ -0,0 +1,489 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Bulk switch scanner
+//
+//  Each tip and ring contact is a bit of a single contacts word (bit 2*p tip, bit 2*p+1 ring).
+//  Every PINx register in use is read once per sample (1 ms) and each contact is debounced by
+//  an integrator: it changes state after scanLimit[] consecutive samples that differ from the
+//  current debounced state. Contacts with nothing going on cost a single test per sample.
+//
+//  Adaptive debounce: the scanner watches every bounce burst (from the first raw change to
+//  DEBOUNCE_INTERVAL ms without changes) and measures its longest interior run, the longest
+//  time the contact looked stable before bouncing again. A limit above that run never accepts
+//  a bounce. Each pedal learns the longest run of its contacts: a longer run raises it at once,
+//  DEBOUNCE_LEARN_EVENTS shorter bursts in a row lower it halfway to the longest of them. The
+//  limit is the learned run plus DEBOUNCE_MARGIN, between DEBOUNCE_MIN and DEBOUNCE_INTERVAL,
+//  so a clean switch settles at a few ms while a worn one keeps the full interval. Learned
+//  values are saved to EEPROM by update_learned_eeprom().
+//
+//  Sampling runs in a SCAN_RATE Hz timer interrupt (Timer1 belongs to MidiTimeCode) and every
+//  debounced change is pushed as a timestamped event into a single-producer/single-consumer
+//  queue drained by midi_refresh(), so the main loop can be late without missing or delaying
+//  any switch transition. While the queue is full a debounced change is not applied: it stays
+//  due in its integrator and goes out with the first sample that finds room.
+//
+//  Edge timestamps: the micros() of the first edge of each contact is kept in scanEdge[] until
+//  the integrator confirms or drops it, and travels with the event (pedal_event.edge). The
+//  sampling interrupt stamps an edge within 1 ms. On the MEGA the contacts wired to PORTB and
+//  PORTK (tips of pedals 14-15, rings of pedals 9-16) are stamped at the edge itself by the pin
+//  change interrupts shared with the jog wheels. scanPressed[] keeps the edge of the last press
+//  of each pedal for the handlers that do not get the event, like tap tempo.
+//
+
+#include <util/atomic.h>
+
+#define SCAN_CONTACTS       (2 * PEDALS)                          // tip and ring of each pedal
+#define SCAN_RATE           1000                                  // sampling interrupt frequency (Hz)
+#define SCAN_MAX_PORTS      8                                     // distinct PINx registers
+#define SCAN_QUEUE_SIZE     8                                     // events, must be a power of 2
+
+#define DEBOUNCE_MIN            3                                 // ms, shortest limit
+#define DEBOUNCE_MARGIN         2                                 // ms above the longest bounce run
+#define DEBOUNCE_LEARN_EVENTS   8                                 // shorter bursts in a row to lower the bounce
+#define DEBOUNCE_BOUNCE_MAX     (DEBOUNCE_INTERVAL - DEBOUNCE_MARGIN)
+
+#define CONTACT_TIP(p)      (2 * (p))
+#define CONTACT_RING(p)     (2 * (p) + 1)
+#define CONTACT_BIT(c)      ((contacts_t)1 << (c))
+
+typedef uint32_t contacts_t;
+
+struct scan_pin {
+  byte                   port;            // index in scanPorts[]
+  byte                   mask;            // bit mask in the PINx register
+  byte                   contact;         // bit in the contacts word
+};
+
+struct pedal_event {
+  unsigned long          time;            // millis() when the change has been debounced
+  unsigned long          edge;            // micros() of the first edge of the changed contacts
+  contacts_t             changed;         // contacts changed
+  contacts_t             state;           // debounced pin level of all the contacts (1 = HIGH)
+#ifdef LATENCY_PEDALINO
+  unsigned long          debounced;       // micros() when the change has been debounced
+#endif
+};
+
+#ifdef ARDUINO_MEGA
+struct scan_pcint {
+  volatile uint8_t      *reg;             // PINx register of the group
+  byte                   mask;            // pins attached to the scanner
+  byte                   level;           // PINx at the previous interrupt
+  byte                   contact[8];      // contact of each pin
+};
+#endif
+
+volatile uint8_t *scanPorts[SCAN_MAX_PORTS];  // PINx registers in use
+byte              scanPortsCount  = 0;
+scan_pin          scanPins[SCAN_CONTACTS];    // attached contacts
+byte              scanPinsCount   = 0;
+
+volatile contacts_t scanState     = 0;        // debounced pin level (1 = HIGH)
+contacts_t        scanRaw         = 0;        // pin level of the last sample
+contacts_t        scanCounting    = 0;        // contacts with an integrator running
+contacts_t        scanBurst       = 0;        // contacts in a bounce burst
+byte              scanCount[SCAN_CONTACTS];   // samples different from the debounced state
+byte              scanLimit[SCAN_CONTACTS];   // samples to accept a new state
+byte              scanRun[SCAN_CONTACTS];     // samples since the last raw change
+byte              scanRunMax[SCAN_CONTACTS];  // longest interior run of the burst
+
+volatile byte     scanBounce[PEDALS];         // longest bounce run learned (ms)
+byte              scanClean[PEDALS];          // shorter bursts in a row
+byte              scanCleanMax[PEDALS];       // longest run of the shorter bursts
+volatile unsigned int scanLearned = 0;        // pedals with a new bounce not yet collected
+unsigned int      debounceDirty   = 0;        // pedals with a bounce not yet in EEPROM (bit mask)
+unsigned long     debounceChanged = 0;        // millis() of the last bounce learned
+
+volatile pedal_event scanQueue[SCAN_QUEUE_SIZE];
+volatile byte     scanQueueHead   = 0;        // written only by the interrupt
+volatile byte     scanQueueTail   = 0;        // written only by the main loop
+volatile byte     scanOverflow    = 0;        // samples an event waited for room in the queue
+
+unsigned long     scanEdge[SCAN_CONTACTS];    // micros() of the first edge seen of each contact
+contacts_t        scanEdgeArmed   = 0;        // contacts with an edge waiting to be debounced
+contacts_t        scanPressLevel  = 0;        // contacts pressed when HIGH (inverted polarity)
+volatile unsigned long scanPressed[PEDALS];   // micros() of the edge of the last press
+#ifdef ARDUINO_MEGA
+scan_pcint        scanPcint[2];               // PCINT0 (PORTB) and PCINT2 (PORTK)
+#endif
+
+//
+//  Stop the sampling interrupt and detach all the contacts
+//
+void scanner_reset()
+{
+#ifdef ARDUINO_MEGA
+  TIMSK3 &= ~(1 << OCIE3A);
+#else
+  TIMSK2 &= ~(1 << OCIE2A);
+#endif
+  scanPortsCount = 0;
+  scanPinsCount  = 0;
+  scanState      = 0;
+  scanRaw        = 0;
+  scanCounting   = 0;
+  scanBurst      = 0;
+  scanEdgeArmed  = 0;
+  scanPressLevel = 0;
+  scanQueueTail  = scanQueueHead;
+#ifdef ARDUINO_MEGA
+  scanPcint[0].mask = 0;
+  scanPcint[1].mask = 0;
+#endif
+}
+
+//
+//  Start the SCAN_RATE Hz sampling interrupt (CTC mode, prescaler 64)
+//
+void scanner_start()
+{
+  noInterrupts();
+#ifdef ARDUINO_MEGA
+  TCCR3A = 0;
+  TCCR3B = (1 << WGM32) | (1 << CS31) | (1 << CS30);
+  TCNT3  = 0;
+  OCR3A  = F_CPU / 64 / SCAN_RATE - 1;
+  TIMSK3 |= (1 << OCIE3A);
+#else
+  TCCR2A = (1 << WGM21);
+  TCCR2B = (1 << CS22);
+  TCNT2  = 0;
+  OCR2A  = F_CPU / 64 / SCAN_RATE - 1;
+  TIMSK2 |= (1 << OCIE2A);
+#endif
+  interrupts();
+}
+
+//
+//  Read all the attached contacts at once (not debounced)
+//
+contacts_t scanner_read()
+{
+  byte        in[SCAN_MAX_PORTS];
+  contacts_t  raw = 0;
+
+  for (byte i = 0; i < scanPortsCount; i++)
+    in[i] = *scanPorts[i];
+
+  for (byte i = 0; i < scanPinsCount; i++)
+    if (in[scanPins[i].port] & scanPins[i].mask) raw |= CONTACT_BIT(scanPins[i].contact);
+
+  return raw;
+}
+
+#ifdef ARDUINO_MEGA
+//
+//  Stamp the contacts of a pin change group at their edge (interrupt only)
+//
+void scanner_pin_change(byte g)
+{
+  scan_pcint    &s     = scanPcint[g];
+  byte           level = *s.reg;
+  byte           edges = (level ^ s.level) & s.mask;
+  unsigned long  now;
+
+  s.level = level;
+  if (edges == 0) return;
+  now = micros();
+  for (byte b = 0; edges; b++, edges >>= 1) {
+    contacts_t c = CONTACT_BIT(s.contact[b]);
+    if (!(edges & 1) || (scanEdgeArmed & c)) continue;
+    if (((level >> b) & 1) == ((scanState & c) != 0)) continue;   // back to the debounced level
+    scanEdge[s.contact[b]] = now;
+    scanEdgeArmed |= c;
+  }
+}
+
+//
+//  Route the pin change interrupt of a pin, if any, to the edge timestamps
+//
+void scanner_pin_attach(byte contact, byte pin)
+{
+  volatile uint8_t *pcicr = digitalPinToPCICR(pin);
+  byte              mask  = digitalPinToBitMask(pin);
+  byte              g;
+  byte              b;
+
+  if (pcicr == 0 || digitalPinToPCICRbit(pin) == PCIE1) return;
+  g = (digitalPinToPCICRbit(pin) == PCIE0) ? 0 : 1;
+  for (b = 0; !(mask & (1 << b)); b++);
+  scanPcint[g].reg        = portInputRegister(digitalPinToPort(pin));
+  scanPcint[g].mask      |= mask;
+  scanPcint[g].level      = *scanPcint[g].reg;
+  scanPcint[g].contact[b] = contact;
+  jog_pin_change(pin);
+}
+#endif
+
+//
+//  Attach a contact to a pin already configured as input (sampling interrupt stopped)
+//
+void scanner_attach(byte contact, byte pin, bool pressedHigh = false)
+{
+  volatile uint8_t *reg = portInputRegister(digitalPinToPort(pin));
+  byte              port;
+
+  if (scanPinsCount >= SCAN_CONTACTS) return;
+
+  for (port = 0; port < scanPortsCount && scanPorts[port] != reg; port++);
+  if (port == scanPortsCount) {
+    if (scanPortsCount >= SCAN_MAX_PORTS) return;
+    scanPorts[scanPortsCount++] = reg;
+  }
+
+  scanPins[scanPinsCount].port    = port;
+  scanPins[scanPinsCount].mask    = digitalPinToBitMask(pin);
+  scanPins[scanPinsCount].contact = contact;
+  scanPinsCount++;
+
+  // Start from the current level without reporting any change
+  if (*reg & digitalPinToBitMask(pin)) scanState |= CONTACT_BIT(contact);
+  else scanState &= ~CONTACT_BIT(contact);
+  scanRaw = scanState;
+  scanCount[contact] = 0;
+  if (pressedHigh) scanPressLevel |= CONTACT_BIT(contact);
+#ifdef ARDUINO_MEGA
+  scanner_pin_attach(contact, pin);
+#endif
+}
+
+//
+//  Set the bounce of a pedal and the debounce limit of its contacts
+//  (sampling interrupt stopped or from the interrupt itself)
+//
+void scanner_bounce(byte p, byte bounce)
+{
+  byte limit;
+
+  bounce        = constrain(bounce, 0, DEBOUNCE_BOUNCE_MAX);
+  limit         = constrain(bounce + DEBOUNCE_MARGIN, DEBOUNCE_MIN, DEBOUNCE_INTERVAL);
+  scanBounce[p] = bounce;
+  scanClean[p]  = 0;
+  scanLimit[CONTACT_TIP(p)]  = limit;
+  scanLimit[CONTACT_RING(p)] = limit;
+}
+
+//
+//  Pedals with a new bounce learned since the last call (main loop only)
+//
+unsigned int scanner_learned()
+{
+  unsigned int learned;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    learned     = scanLearned;
+    scanLearned = 0;
+  }
+  return learned;
+}
+
+//
+//  Debounced level of all the contacts
+//
+contacts_t scanner_state()
+{
+  contacts_t state;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    state = scanState;
+  }
+  return state;
+}
+
+//
+//  millis() of the edge of the last press of a pedal (main loop only)
+//
+unsigned long scanner_pressed(byte p)
+{
+  unsigned long edge;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    edge = scanPressed[p];
+  }
+  return millis() - (micros() - edge) / 1000;
+}
+
+//
+//  Get the oldest debounced change, if any (main loop only)
+//
+bool scanner_pop(pedal_event &e)
+{
+  byte tail = scanQueueTail;
+
+  if (tail == scanQueueHead) return false;
+  e.time    = scanQueue[tail].time;
+  e.edge    = scanQueue[tail].edge;
+  e.changed = scanQueue[tail].changed;
+  e.state   = scanQueue[tail].state;
+#ifdef LATENCY_PEDALINO
+  e.debounced = scanQueue[tail].debounced;
+#endif
+  scanQueueTail = (tail + 1) & (SCAN_QUEUE_SIZE - 1);
+  return true;
+}
+
+//
+//  Remember the first edge of each contact, a bounce back within DEBOUNCE_INTERVAL keeps it
+//  (interrupt only)
+//
+void scanner_edges(contacts_t delta, unsigned long now)
+{
+  contacts_t start = delta & ~scanEdgeArmed;
+  contacts_t walk  = start | (scanEdgeArmed & ~delta);    // new edges and armed contacts back
+  contacts_t b     = 1;
+
+  for (byte c = 0; walk; c++, b <<= 1) {
+    if (!(walk & b)) continue;
+    walk &= ~b;
+    if (start & b) scanEdge[c] = now;
+    else if (now - scanEdge[c] > DEBOUNCE_INTERVAL * 1000UL) scanEdgeArmed &= ~b;   // glitch
+  }
+  scanEdgeArmed |= start;
+}
+
+//
+//  Earliest edge of the contacts just debounced, the presses are remembered (interrupt only)
+//
+unsigned long scanner_edge(contacts_t toggle, unsigned long now)
+{
+  unsigned long first = now;
+  unsigned long edge;
+  contacts_t    walk  = toggle;
+  contacts_t    b     = 1;
+
+  for (byte c = 0; walk; c++, b <<= 1) {
+    if (!(walk & b)) continue;
+    walk &= ~b;
+    edge = (scanEdgeArmed & b) ? scanEdge[c] : now;
+    if (now - edge > now - first) first = edge;
+    if (!((scanState ^ scanPressLevel) & b)) scanPressed[c / 2] = edge;
+  }
+  scanEdgeArmed &= ~toggle;
+  return first;
+}
+
+//
+//  Learn from the longest interior run of a bounce burst of a pedal contact (interrupt only)
+//
+void scanner_learn(byte p, byte run)
+{
+  byte bounce = scanBounce[p];
+
+  if (run >= bounce) {
+    scanClean[p] = 0;
+    if (run == bounce) return;
+    bounce = run;
+  }
+  else {
+    if (scanClean[p] == 0 || run > scanCleanMax[p]) scanCleanMax[p] = run;
+    if (++scanClean[p] < DEBOUNCE_LEARN_EVENTS) return;
+    bounce = (bounce + scanCleanMax[p]) / 2;          // halfway to the longest run seen meanwhile
+  }
+  scanner_bounce(p, bounce);
+  scanLearned |= (1U << p);
+}
+
+//
+//  Sample and debounce all the contacts (interrupt only)
+//
+void scanner_sample()
+{
+  contacts_t  raw;
+  contacts_t  delta;
+  contacts_t  active;
+  contacts_t  toggle = 0;
+  contacts_t  b = 1;
+  byte        head = scanQueueHead;
+  bool        full;
+  unsigned long now;
+  unsigned long edge;
+
+  raw    = scanner_read();
+  delta  = raw ^ scanState;                        // contacts different from the debounced state
+  active = delta | scanCounting | scanBurst | (raw ^ scanRaw);
+  if (active == 0) return;
+  now = micros();
+  scanner_edges(delta, now);
+  full = ((head + 1) & (SCAN_QUEUE_SIZE - 1)) == scanQueueTail;
+
+  for (byte c = 0; active; c++, b <<= 1) {
+    if (!(active & b)) continue;
+    active &= ~b;
+
+    // Bounce burst measurement
+    if ((raw ^ scanRaw) & b) {
+      if (scanBurst & b) { if (scanRun[c] > scanRunMax[c]) scanRunMax[c] = scanRun[c]; }
+      else {
+        scanBurst    |= b;
+        scanRunMax[c] = 0;
+      }
+      scanRun[c] = 0;
+    }
+    else if (scanRun[c] < DEBOUNCE_INTERVAL) scanRun[c]++;
+    if ((scanBurst & b) && scanRun[c] >= DEBOUNCE_INTERVAL) {
+      scanBurst &= ~b;
+      scanner_learn(c / 2, scanRunMax[c]);
+    }
+
+    // Integrator, a contact due while the queue is full stays due until the next sample
+    if (delta & b) {
+      scanCounting |= b;
+      if (scanCount[c] < scanLimit[c]) scanCount[c]++;
+      if (scanCount[c] >= scanLimit[c]) {
+        if (full) scanOverflow++;
+        else toggle |= b;
+      }
+    }
+    if (!(delta & b) || (toggle & b)) {
+      scanCounting &= ~b;
+      scanCount[c] = 0;
+    }
+  }
+  scanRaw = raw;
+  if (toggle == 0) return;
+  scanState ^= toggle;
+  edge = scanner_edge(toggle, now);
+
+  scanQueue[head].time    = millis();
+  scanQueue[head].edge    = edge;
+  scanQueue[head].changed = toggle;
+  scanQueue[head].state   = scanState;
+#ifdef LATENCY_PEDALINO
+  scanQueue[head].debounced = now;
+#endif
+  scanQueueHead = (head + 1) & (SCAN_QUEUE_SIZE - 1);
+}
+
+#ifdef ARDUINO_MEGA
+ISR(TIMER3_COMPA_vect)
+#else
+ISR(TIMER2_COMPA_vect)
+#endif
+{
+  jog_sample();
+  scanner_sample();
+  dinPort.pump(MIDI_PORT_BURST);
+}
+
+#ifdef ARDUINO_MEGA
+ISR(PCINT0_vect)
+{
+  jog_sample();
+  scanner_pin_change(0);
+}
+
+ISR(PCINT2_vect)
+{
+  jog_sample();
+  scanner_pin_change(1);
+}
+#endif
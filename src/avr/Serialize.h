@@ -10,6 +10,19 @@
 
 #include <ArduinoJson.h>                // https://arduinojson.org/
 
+//
+//  JSON to the ESP wrapped in a SysEx: the queued MIDI goes first, then it waits for the UART
+//
+void serialize_send(JsonObject &root) {
+
+  espPort.hold();
+  Serial3.write(0xF0);
+  root.printTo(Serial3);
+  Serial3.write(0xF7);
+  Serial3.flush();
+  espPort.resume();
+}
+
 
 void serialize_lcd1(const char *l) {
 
@@ -21,10 +34,7 @@ void serialize_lcd1(const char *l) {
 
   root["lcd1"] = String(l);
 
-  Serial3.write(0xF0);
-  root.printTo(Serial3);
-  Serial3.write(0xF7);
-  Serial3.flush();
+  serialize_send(root);
   /*
     root.printTo(originalSysEx, sizeof(originalSysEx));
     for (unsigned int i = 0; i < strlen(originalSysEx); i++)
@@ -48,10 +58,7 @@ void serialize_lcd2(const char *l) {
 
   root["lcd2"] = String(l);
 
-  Serial3.write(0xF0);
-  root.printTo(Serial3);
-  Serial3.write(0xF7);
-  Serial3.flush();
+  serialize_send(root);
 }
 
 void serialize_lcd_clear() {
@@ -61,10 +68,7 @@ void serialize_lcd_clear() {
 
   root["lcd.clear"] = true;
 
-  Serial3.write(0xF0);
-  root.printTo(Serial3);
-  Serial3.write(0xF7);
-  Serial3.flush();
+  serialize_send(root);
 }
 
 void serialize_factory_default() {
@@ -74,10 +78,7 @@ void serialize_factory_default() {
 
   root["factory.default"] = true;
 
-  Serial3.write(0xF0);
-  root.printTo(Serial3);
-  Serial3.write(0xF7);
-  Serial3.flush();
+  serialize_send(root);
 
   DPRINTLN("JSON: factory.default");
 }
@@ -96,10 +97,7 @@ void serialize_bank(byte b = currentBank, byte p = currentPedal) {
   root["value2"]  = banks[b][p].midiValue2;
   root["value3"]  = banks[b][p].midiValue3;
 
-  Serial3.write(0xF0);
-  root.printTo(Serial3);
-  Serial3.write(0xF7);
-  Serial3.flush();
+  serialize_send(root);
 }
 
 void serialize_banks() {
@@ -119,15 +117,15 @@ void serialize_pedal(byte p = currentPedal) {
   root["autosensing"]     = pedals[p].autoSensing;
   root["mode"]            = pedals[p].mode;
   root["pressmode"]       = pedals[p].pressMode;
+  root["speculative"]     = pedals[p].speculative;
   root["invertpolarity"]  = pedals[p].invertPolarity;
   root["mapfunction"]     = pedals[p].mapFunction;
   root["expzero"]         = pedals[p].expZero;
   root["expmax"]          = pedals[p].expMax;
+  root["filtercutoff"]    = FILTER_TUNING(pedals[p].filterCutoff);
+  root["filterbeta"]      = FILTER_TUNING(pedals[p].filterBeta);
 
-  Serial3.write(0xF0);
-  root.printTo(Serial3);
-  Serial3.write(0xF7);
-  Serial3.flush();
+  serialize_send(root);
 }
 
 void serialize_pedals() {
@@ -136,6 +134,55 @@ void serialize_pedals() {
     serialize_pedal(p);
 }
 
+void serialize_chord(byte c) {
+
+  StaticJsonBuffer<300> jsonBuffer;
+  JsonObject& root = jsonBuffer.createObject();
+
+  root["chord"]   = c;
+  root["pedals"]  = chords[c].pedals;
+  JsonArray& messages = root.createNestedArray("messages");
+  for (byte m = 0; m < chords[c].messages; m++) {
+    JsonArray& message = messages.createNestedArray();
+    message.add(chords[c].message[m].midiMessage);
+    message.add(chords[c].message[m].midiChannel);
+    message.add(chords[c].message[m].midiCode);
+    message.add(chords[c].message[m].midiValue);
+  }
+
+  serialize_send(root);
+}
+
+void serialize_chords() {
+
+  for (byte c = 0; c < CHORDS; c++)
+    serialize_chord(c);
+}
+
+void serialize_macro(byte m) {
+
+  StaticJsonBuffer<300> jsonBuffer;
+  JsonObject& root = jsonBuffer.createObject();
+
+  root["macro"]   = m;
+  JsonArray& messages = root.createNestedArray("messages");
+  for (byte i = 0; i < macros[m].messages; i++) {
+    JsonArray& message = messages.createNestedArray();
+    message.add(macros[m].message[i].midiMessage);
+    message.add(macros[m].message[i].midiChannel);
+    message.add(macros[m].message[i].midiCode);
+    message.add(macros[m].message[i].midiValue);
+  }
+
+  serialize_send(root);
+}
+
+void serialize_macros() {
+
+  for (byte m = 0; m < MACROS; m++)
+    serialize_macro(m);
+}
+
 void serialize_interface(byte i = currentInterface) {
 
   StaticJsonBuffer<200> jsonBuffer;
@@ -148,10 +195,7 @@ void serialize_interface(byte i = currentInterface) {
   root["routing"]   = interfaces[i].midiRouting;
   root["clock"]     = interfaces[i].midiClock;
 
-  Serial3.write(0xF0);
-  root.printTo(Serial3);
-  Serial3.write(0xF7);
-  Serial3.flush();
+  serialize_send(root);
 }
 
 void serialize_interfaces() {
@@ -168,8 +212,5 @@ void serialize_wifi_credentials(const char *ssid, const char *password) {
   root["ssid"]      = String(ssid);
   root["password"]  = String(password);
   
-  Serial3.write(0xF0);
-  root.printTo(Serial3);
-  Serial3.write(0xF7);
-  Serial3.flush();
+  serialize_send(root);
 }
\ No newline at end of file
@@ -193,6 +193,24 @@ HardwareSerial                SerialMIDI(2);
 
 MIDI_CREATE_CUSTOM_INSTANCE(HardwareSerial, SerialMIDI, MIDI, SerialMIDISettings);
 
+// Edge timestamps: while a BLE client is connected Pedalino precedes the first message of a pedal
+// event with the age of its edge (SysEx F0 7D <age in us, 3 x 7 bits> F7). The event time applies
+// to the messages received within SERIALMIDI_EDGE_HOLD ms, the following ones are stamped when
+// forwarded.
+
+#define SERIALMIDI_EDGE_ID    0x7D
+#define SERIALMIDI_EDGE_HOLD  2
+
+unsigned long serialEdgeTime     = 0;   // millis() of the edge of the last pedal event
+unsigned long serialEdgeReceived = 0;   // millis() when its timestamp has been received
+
+unsigned long serial_event_time()
+{
+  unsigned long now = millis();
+
+  return (now - serialEdgeReceived <= SERIALMIDI_EDGE_HOLD) ? serialEdgeTime : now;
+}
+
 // ipMIDI
 
 #ifndef NOWIFI
@@ -526,7 +544,14 @@ void BLEMidiTimestamp (uint8_t *header, uint8_t *timestamp)
     and the MSB of both bytes are set to indicate that this is a header byte.
     Both bytes are placed into the first two position of an array in preparation for a MIDI message.
   */
-  unsigned long currentTimeStamp = millis() & 0x01FFF;
+  static unsigned long lastTimeStamp = 0;
+
+  // Time of the pedal event, never before the previous message (monotonically increasing)
+  unsigned long eventTime = serial_event_time();
+  if ((long)(eventTime - lastTimeStamp) < 0) eventTime = lastTimeStamp;
+  lastTimeStamp = eventTime;
+
+  unsigned long currentTimeStamp = eventTime & 0x01FFF;
 
   *header = ((currentTimeStamp >> 7) & 0x3F) | 0x80;        // 6 bits plus MSB
   *timestamp = (currentTimeStamp & 0x7F) | 0x80;            // 7 bits plus MSB
@@ -1402,6 +1427,13 @@ void OnSerialMidiPitchBend(byte channel, int bend)
 
 void OnSerialMidiSystemExclusive(byte* array, unsigned size)
 {
+  if (size == 6 && array[1] == SERIALMIDI_EDGE_ID) {
+    unsigned long age = array[2] | (array[3] << 7) | ((unsigned long)array[4] << 14);
+    serialEdgeReceived = millis();
+    serialEdgeTime     = serialEdgeReceived - age / 1000;
+    return;
+  }
+
   char json[size - 1];
   //byte decodedArray[size];
   //unsigned int decodedSize;
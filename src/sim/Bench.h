@@ -0,0 +1,160 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Code path benchmarks of the simulator (-b name)
+//
+//  Built into the firmware of the host simulator only (Pedalino.cpp includes it when
+//  _SIMULATOR_H is defined), so both paths run against the firmware state left by setup():
+//  the configuration of the EEPROM image given with -e, or the factory default.
+//
+//  Each benchmark has a before path, the code replaced kept here as the reference, and an
+//  after path, the firmware one. The pins follow the trace while they run.
+//
+//      debounce  one Bounce2 object per contact attached to the scanner, updated as
+//                midi_refresh() used to do, against scanner_sample() and scanner_pop()
+//      curve     the float log() and exp() formulas map_analog() used to apply, against the
+//                flash table lookups, one log and one anti-log value per call over the whole
+//                input range. The host has a floating point unit, the AVR emulates it in
+//                software: the host ratio is a lower bound of the one on the board
+//      dispatch  the walk of every pedal through the function, mode and press mode switches
+//                midi_refresh() used to do on each loop, against midi_refresh() and its
+//                handler tables. Both call the same handlers, with send false
+//
+
+//
+//  debounce
+//
+
+Bounce  benchBounce[SCAN_CONTACTS];
+byte    benchBounceCount = 0;
+
+void bench_debounce_setup()
+{
+  for (byte i = 0; i < scanPinsCount; i++) {
+    byte c = scanPins[i].contact;
+    benchBounce[benchBounceCount].attach(c & 1 ? PIN_A(c / 2) : PIN_D(c / 2));
+    benchBounce[benchBounceCount].interval(DEBOUNCE_INTERVAL);
+    benchBounceCount++;
+  }
+}
+
+void bench_debounce_before()
+{
+  for (byte i = 0; i < benchBounceCount; i++)
+    if (benchBounce[i].update()) benchBounce[i].read();
+}
+
+void bench_debounce_after()
+{
+  pedal_event e;
+
+  scanner_sample();
+  while (scanner_pop(e));
+}
+
+//
+//  curve
+//
+
+unsigned int          benchCurveInput = 0;
+volatile unsigned int benchCurveOutput;     // keeps the results alive
+
+void bench_curve_setup()
+{
+  benchCurveInput = 0;
+}
+
+void bench_curve_before()
+{
+  unsigned int value = benchCurveInput++ & (ADC_RESOLUTION - 1);
+
+  benchCurveOutput = round(log(value + 1) * 147.61);
+  benchCurveOutput = round((exp(value / 511.5) - 1) * 160.12);
+}
+
+void bench_curve_after()
+{
+  unsigned int value = (benchCurveInput++ & (ADC_RESOLUTION - 1)) << (CURVE_BITS - 10);
+
+  benchCurveOutput = curve_lookup(curveLog, value, curveLogHead);
+  benchCurveOutput = curve_lookup(curveAntiLog, value);
+}
+
+//
+//  dispatch
+//
+
+contacts_t  benchDispatchState;             // contacts level at the previous call of the walk
+
+void bench_dispatch_setup()
+{
+  benchDispatchState = scanner_state();
+}
+
+void bench_dispatch_before()
+{
+  contacts_t  state = scanner_state();
+  pedal_event e;
+
+  while (scanner_pop(e));
+  for (byte i = 0; i < PEDALS; i++) {
+    if (pedals[i].function != PED_MIDI) continue;
+    if (i == autosensingPedal) continue;
+    switch (pedals[i].mode) {
+
+      case PED_MOMENTARY1:
+      case PED_MOMENTARY2:
+      case PED_MOMENTARY3:
+      case PED_LATCH1:
+      case PED_LATCH2:
+        switch (pedals[i].pressMode) {
+
+          case PED_PRESS_1:
+            if ((state ^ benchDispatchState) & CONTACT_BIT(CONTACT_TIP(i)))
+              pedalStates[i].pedalValue[0] = ((state >> CONTACT_TIP(i)) & 1) ^ pedals[i].invertPolarity;
+            if ((state ^ benchDispatchState) & CONTACT_BIT(CONTACT_RING(i)))
+              pedalStates[i].pedalValue[1] = ((state >> CONTACT_RING(i)) & 1) ^ pedals[i].invertPolarity;
+            break;
+
+          default:
+            if (pedals[i].mode == PED_LATCH1 || pedals[i].mode == PED_LATCH2) break;
+            midi_refresh_press(i, state, false);
+            break;
+        }
+        break;
+
+      case PED_ANALOG:
+        if (pool_analog(i) != nullptr) midi_refresh_analog(i, state, false);
+        break;
+
+      case PED_LADDER:
+        if (ladder_decoder_of(i) != LADDER_NONE) midi_refresh_ladder(i, state, false);
+        break;
+
+      case PED_JOG_WHEEL:
+        midi_refresh_jog(i, state, false);
+        break;
+    }
+  }
+  benchDispatchState = state;
+}
+
+void bench_dispatch_after()
+{
+  midi_refresh(false);
+}
+
+const sim_bench simBenches[] = {
+  { "debounce", bench_debounce_setup, bench_debounce_before, bench_debounce_after },
+  { "curve",    bench_curve_setup,    bench_curve_before,    bench_curve_after },
+  { "dispatch", bench_dispatch_setup, bench_dispatch_before, bench_dispatch_after },
+  { nullptr,    nullptr,              nullptr,               nullptr }
+};
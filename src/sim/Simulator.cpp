@@ -0,0 +1,785 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Host simulator of the Pedalino MEGA board
+//
+//  Runs the unmodified firmware (setup() and loop()) against the mock HAL in hal/ on a virtual
+//  clock, replays a trace of pin levels and captures every byte written to the serial ports.
+//
+//  Trace file, one change per line (# starts a comment):
+//
+//      <time ms> <pin> <value>
+//
+//      pin     D0-D69 digital pin or A0-A15 analog input
+//      value   0/1 for digital pins, 0-1023 for analog inputs, Z to leave the pin floating
+//
+//  Capture file, one line per input change and per byte received at the other end of a
+//  serial line (after the stop bit at the configured baud rate):
+//
+//      <time us> IN <pin> <value>
+//      <time us> <USB|BT|DIN|ESP> <hex byte>
+//
+//  Virtual time only moves when the firmware uses the hardware, at the costs estimated in
+//  hal/Simulator.h, so loop timings compare configurations and code paths, they are not cycle
+//  accurate. The host time of loop() is reported too.
+//
+//  Filter bench (-f A<n>): every value of the analog pedal on A<n> filtered by the firmware is
+//  compared with the trace, the noise-free reference (sweep.trace is an example). -n adds a
+//  uniform noise of +/- n LSB to each ADC conversion. Reported metrics:
+//
+//      lag      delay of the output that best fits the reference (least squares, 0-100 ms)
+//      error    RMS distance from the reference delayed by the lag
+//      jitter   worst peak-to-peak of the output, and of the input, while the reference is at
+//               rest since SIM_BENCH_SETTLE ms, and the output changes counted meanwhile
+//
+//  Code path benchmarks (-b name, listed in Bench.h): after setup(), with interrupts disabled,
+//  the code path replaced and the firmware one run SIM_BENCH_ROUNDS times each instead of
+//  loop(), one call every ms of virtual time. The trace is replayed from the same point for
+//  each path, so both see the same pin changes. The virtual time per call counts the hardware
+//  accesses only. The host time per call includes the simulation of those accesses, the cost
+//  of an empty call is subtracted.
+//
+//  Usage: pedalino-sim [-t trace] [-o capture] [-d duration ms] [-e eeprom image]
+//                      [-f analog pin] [-n adc noise] [-b benchmark]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#define SIM_NEVER           UINT64_MAX
+#define SIM_SERIAL_PORTS    4
+#define SIM_SERIAL_BUFFER   64              // HardwareSerial TX buffer
+#define SIM_US(c)           ((double)(c) / (SIM_CPU_HZ / 1000000))
+#define SIM_ADC_HIRES_BITS  2                   // oversampled values of the analog scanner
+#define SIM_BENCH_SETTLE    300                 // ms
+#define SIM_BENCH_LAG_MAX   100                 // ms
+#define SIM_BENCH_LAG_STEP  0.25                // ms
+#define SIM_BENCH_ROUNDS    100000
+#define SIM_BENCH_STEP      (SIM_CPU_HZ / 1000)   // cycles between two calls
+
+//
+//  Hardware state
+//
+
+volatile bool     simInterrupts = false;
+uint8_t           simPins[SIM_PORTS];
+
+sim_reg8          TCCR1A, TCCR1B, TIMSK1;
+sim_reg16         TCNT1, OCR1A;
+sim_reg8          TCCR3A, TCCR3B, TIMSK3;
+sim_reg16         TCNT3, OCR3A;
+sim_reg8          ADCSRA, ADCSRB, ADMUX;
+sim_reg16         ADC;
+volatile uint8_t  PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+
+EEPROMClass       EEPROM;
+
+HardwareSerial    Serial(0);
+HardwareSerial    Serial1(1);
+HardwareSerial    Serial2(2);
+HardwareSerial    Serial3(3);
+
+// avr-libc heap limits used by free_memory(): on the host only the stack depth is meaningful
+char              __heap_start;
+char             *__brkval = nullptr;
+
+// Vectors not defined by the firmware
+extern "C" {
+void __attribute__((weak)) sim_timer1_compa_vect() {}
+void __attribute__((weak)) sim_timer3_compa_vect() {}
+void __attribute__((weak)) sim_adc_vect() {}
+void __attribute__((weak)) sim_pcint0_vect() {}
+void __attribute__((weak)) sim_pcint1_vect() {}
+void __attribute__((weak)) sim_pcint2_vect() {}
+}
+
+struct sim_pin {
+  uint8_t   mode;
+  uint8_t   latch;                          // PORTx bit: output level or pull-up
+  int16_t   input;                          // level driven by the trace (0-1023), -1 floating
+};
+
+struct sim_timer {
+  sim_reg8  *tccrb;
+  sim_reg16 *ocr;
+  sim_reg16 *tcnt;
+  sim_reg8  *timsk;
+  void     (*vector)();
+  uint64_t   period;                        // cycles between two compare matches
+  uint64_t   next;                          // cycle of the next compare match
+  bool       pending;
+  unsigned long count;
+};
+
+struct sim_serial {
+  unsigned long baud;
+  uint64_t   free;                          // cycle the line ends the transmission in progress
+  unsigned long bytes;
+};
+
+struct sim_trace_event {
+  uint64_t   time;
+  uint8_t    pin;
+  int16_t    value;
+};
+
+struct sim_record {
+  uint64_t   time;
+  uint8_t    port;                          // 0xFF for an input change
+  uint8_t    pin;
+  int16_t    value;
+};
+
+struct sim_bench_sample {
+  uint64_t   time;
+  uint16_t   input;
+  uint16_t   output;
+};
+
+static const char *simPortNames[SIM_SERIAL_PORTS] = { "USB", "BT", "DIN", "ESP" };
+static const byte  simAdcPrescaler[8] = { 2, 2, 4, 8, 16, 32, 64, 128 };
+
+static uint64_t    now = 0;
+static sim_pin     pins[SIM_PINS];
+static sim_timer   timers[2] = {
+  { &TCCR1B, &OCR1A, &TCNT1, &TIMSK1, sim_timer1_compa_vect, 0, SIM_NEVER, false, 0 },
+  { &TCCR3B, &OCR3A, &TCNT3, &TIMSK3, sim_timer3_compa_vect, 0, SIM_NEVER, false, 0 }
+};
+static uint64_t    adcDone      = SIM_NEVER;  // end of the conversion in progress
+static byte        adcChannel   = 0;
+static bool        adcFlag      = false;      // ADIF
+static bool        adcFirst     = true;       // next conversion is the first after ADEN
+static unsigned long adcCount   = 0;
+static unsigned long pcintCount = 0;
+static sim_serial  serials[SIM_SERIAL_PORTS];
+static unsigned long eepromWrites = 0;
+
+static std::vector<sim_trace_event> trace;
+static size_t      traceNext = 0;
+static uint64_t    traceShift = 0;            // replay offset of the trace
+static std::vector<sim_record> capture;
+static FILE       *captureFile = stdout;
+static const char *eepromFile  = NULL;
+static int         adcNoise    = 0;           // +/- LSB added to each conversion
+static int         benchPin    = -1;          // analog pin of the filter bench
+static std::vector<sim_bench_sample> bench;
+static const sim_bench *codeBench = NULL;     // code path benchmark
+static uint64_t    codeBenchStart;
+static size_t      codeBenchTrace;
+static sim_pin     codeBenchPins[SIM_PINS];
+
+//
+//  Pins
+//
+
+static bool pin_pullup(const sim_pin &p)
+{
+  return p.mode == INPUT_PULLUP || (p.mode == INPUT && p.latch);
+}
+
+static byte pin_level(byte pin)
+{
+  const sim_pin &p = pins[pin];
+
+  if (p.mode == OUTPUT) return p.latch;
+  if (p.input >= 0)     return p.input >= 512;
+  return pin_pullup(p);
+}
+
+static int pin_analog(byte pin)
+{
+  const sim_pin &p = pins[pin];
+
+  if (p.mode == OUTPUT) return p.latch ? 1023 : 0;
+  if (p.input >= 0)     return p.input;
+  if (pin_pullup(p))    return 1023;
+  return rand() % 1024;                       // floating input
+}
+
+//
+//  Refresh the PINx bit of a pin and flag the pin change interrupt of its group
+//
+static void pin_update(byte pin)
+{
+  byte  port  = digitalPinToPort(pin) - 1;
+  byte  mask  = digitalPinToBitMask(pin);
+  byte  level = pin_level(pin) ? mask : 0;
+
+  if ((simPins[port] & mask) == level) return;
+  simPins[port] ^= mask;
+
+  volatile uint8_t *pcmsk = digitalPinToPCMSK(pin);
+  if (pcmsk != 0 && (*pcmsk & (1 << digitalPinToPCMSKbit(pin))))
+    PCIFR |= 1 << digitalPinToPCICRbit(pin);
+}
+
+void sim_pin_mode(uint8_t pin, uint8_t mode)
+{
+  if (pin >= SIM_PINS) return;
+  pins[pin].mode = mode;
+  if (mode == INPUT_PULLUP) pins[pin].latch = HIGH;
+  if (mode == INPUT) pins[pin].latch = LOW;
+  pin_update(pin);
+}
+
+void sim_pin_write(uint8_t pin, uint8_t value)
+{
+  if (pin >= SIM_PINS) return;
+  pins[pin].latch = value ? HIGH : LOW;
+  pin_update(pin);
+}
+
+int sim_pin_read(uint8_t pin)
+{
+  if (pin >= SIM_PINS) return LOW;
+  return pin_level(pin);
+}
+
+//
+//  Timers (CTC mode on OCRnA, the counter itself is not simulated)
+//
+
+static void timer_program(sim_timer &t)
+{
+  static const uint16_t prescaler[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+  uint16_t ps  = prescaler[t.tccrb->raw() & 0x07];
+  uint32_t top = (t.tccrb->raw() & (1 << WGM12)) ? t.ocr->raw() + 1UL : 0x10000UL;
+
+  if (ps == 0) {
+    t.period = 0;
+    t.next   = SIM_NEVER;
+    return;
+  }
+  t.period = (uint64_t)top * ps;
+  t.next   = now + t.period - std::min<uint64_t>(t.tcnt->raw(), top - 1) * ps;
+}
+
+//
+//  ADC: 13 ADC clocks per conversion, 25 for the first one after enabling it
+//
+
+static void adc_written()
+{
+  byte v = ADCSRA.raw();
+
+  if (v & (1 << ADIF)) adcFlag = false;       // write one to clear
+  if (!(v & (1 << ADEN))) {
+    adcDone  = SIM_NEVER;
+    adcFirst = true;
+    v &= ~(1 << ADSC);
+  }
+  else if (adcDone != SIM_NEVER) v |= (1 << ADSC);   // writing zero has no effect
+  else if (v & (1 << ADSC)) {
+    adcChannel = (ADMUX.raw() & 0x07) | ((ADCSRB.raw() & (1 << MUX5)) ? 0x08 : 0);
+    adcDone    = now + (adcFirst ? 25 : 13) * simAdcPrescaler[v & 0x07];
+    adcFirst   = false;
+  }
+  ADCSRA.set(adcFlag ? (v | (1 << ADIF)) : (v & ~(1 << ADIF)));
+}
+
+static void adc_complete()
+{
+  adcDone = SIM_NEVER;
+  adcFlag = true;
+  adcCount++;
+  int value = pin_analog(PIN_A0 + adcChannel);
+  if (adcNoise) value = constrain(value + rand() % (2 * adcNoise + 1) - adcNoise, 0, 1023);
+  ADC.set(value);
+  ADCSRA.set((ADCSRA.raw() & ~(1 << ADSC)) | (1 << ADIF));
+}
+
+void sim_register_written(const volatile void *reg)
+{
+  if (reg == &ADCSRA) adc_written();
+  for (byte i = 0; i < 2; i++)
+    if (reg == timers[i].tccrb || reg == timers[i].ocr || reg == timers[i].tcnt) timer_program(timers[i]);
+}
+
+//
+//  Serial ports: each byte takes 10 bits on the line after the ones already queued
+//
+
+static uint64_t serial_byte_time(const sim_serial &s)
+{
+  return s.baud ? 10 * SIM_CPU_HZ / s.baud : 0;
+}
+
+void sim_serial_begin(uint8_t port, unsigned long baud)
+{
+  serials[port].baud = baud;
+  serials[port].free = now;
+}
+
+int sim_serial_room(uint8_t port)
+{
+  const sim_serial &s = serials[port];
+  uint64_t          bt = serial_byte_time(s);
+  uint64_t          queued;
+
+  sim_advance(SIM_CYCLES_REGISTER);
+  if (bt == 0 || s.free <= now) return SIM_SERIAL_BUFFER;
+  queued = (s.free - now + bt - 1) / bt - 1;  // the first one is in the shift register
+  return queued >= SIM_SERIAL_BUFFER ? 0 : SIM_SERIAL_BUFFER - queued;
+}
+
+void sim_serial_write(uint8_t port, uint8_t b)
+{
+  sim_serial &s  = serials[port];
+  uint64_t    bt = serial_byte_time(s);
+
+  while (sim_serial_room(port) == 0)          // HardwareSerial blocks on a full buffer
+    sim_advance(s.free - now - SIM_SERIAL_BUFFER * bt);
+  sim_advance(SIM_CYCLES_SERIAL);
+
+  s.free = std::max(s.free, now) + bt;
+  s.bytes++;
+  capture.push_back({ s.free, port, 0, b });
+}
+
+void sim_serial_flush(uint8_t port)
+{
+  if (serials[port].free > now) sim_advance(serials[port].free - now);
+}
+
+void sim_eeprom_written()
+{
+  eepromWrites++;
+}
+
+//
+//  Clock and interrupts
+//
+
+uint64_t sim_cycles()
+{
+  return now;
+}
+
+static void sim_run(uint64_t until);
+
+static void sim_dispatch(void (*vector)())
+{
+  simInterrupts = false;
+  vector();
+  sim_run(now + SIM_CYCLES_ISR);
+  simInterrupts = true;
+}
+
+//
+//  Execute the pending interrupts in the priority order of their vectors
+//
+void sim_poll()
+{
+  while (simInterrupts) {
+    byte pcint = PCIFR & PCICR;
+
+    if (pcint) {
+      byte group = pcint & 0x01 ? 0 : (pcint & 0x02 ? 1 : 2);
+      void (*vectors[3])() = { sim_pcint0_vect, sim_pcint1_vect, sim_pcint2_vect };
+      PCIFR &= ~(1 << group);
+      pcintCount++;
+      sim_dispatch(vectors[group]);
+    }
+    else if (timers[0].pending) {
+      timers[0].pending = false;
+      timers[0].count++;
+      sim_dispatch(timers[0].vector);
+    }
+    else if (adcFlag && (ADCSRA.raw() & (1 << ADIE))) {
+      adcFlag = false;
+      ADCSRA.set(ADCSRA.raw() & ~(1 << ADIF));
+      sim_dispatch(sim_adc_vect);
+    }
+    else if (timers[1].pending) {
+      timers[1].pending = false;
+      timers[1].count++;
+      sim_dispatch(timers[1].vector);
+    }
+    else break;
+  }
+}
+
+static void trace_apply(const sim_trace_event &e)
+{
+  pins[e.pin].input = e.value;
+  pin_update(e.pin);
+  capture.push_back({ now, 0xFF, e.pin, e.value });
+}
+
+//
+//  Run the hardware up to the given cycle, interrupts included
+//
+static void sim_run(uint64_t until)
+{
+  for (;;) {
+    uint64_t t = adcDone;
+
+    for (byte i = 0; i < 2; i++) t = std::min(t, timers[i].next);
+    if (traceNext < trace.size()) t = std::min(t, trace[traceNext].time + traceShift);
+    if (t > until) break;
+    if (t > now) now = t;
+
+    while (traceNext < trace.size() && trace[traceNext].time + traceShift <= now) trace_apply(trace[traceNext++]);
+    if (adcDone <= now) adc_complete();
+    for (byte i = 0; i < 2; i++)
+      if (timers[i].next <= now) {
+        timers[i].next += timers[i].period;
+        if (timers[i].timsk->raw() & (1 << OCIE1A)) timers[i].pending = true;
+      }
+    sim_poll();
+  }
+  if (until > now) now = until;
+}
+
+void sim_advance(uint32_t cycles)
+{
+  sim_run(now + cycles);
+}
+
+//
+//  Trace, capture and EEPROM image files
+//
+
+static bool trace_load(const char *name)
+{
+  FILE *f = fopen(name, "r");
+  char  line[128];
+  int   n = 0;
+
+  if (f == NULL) return false;
+  while (fgets(line, sizeof(line), f)) {
+    double  ms;
+    char    pin[8], value[8];
+    int     p;
+    sim_trace_event e;
+
+    n++;
+    if (line[strspn(line, " \t\r\n")] == '#' || strspn(line, " \t\r\n") == strlen(line)) continue;
+    if (sscanf(line, "%lf %7s %7s", &ms, pin, value) != 3 || ms < 0 ||
+        (toupper(pin[0]) != 'D' && toupper(pin[0]) != 'A') || sscanf(pin + 1, "%d", &p) != 1) {
+      fprintf(stderr, "%s:%d: invalid line\n", name, n);
+      continue;
+    }
+    if (toupper(pin[0]) == 'A') p += PIN_A0;
+    if (p < 0 || p >= SIM_PINS) {
+      fprintf(stderr, "%s:%d: invalid pin %s\n", name, n, pin);
+      continue;
+    }
+    e.time  = (uint64_t)(ms * (SIM_CPU_HZ / 1000));
+    e.pin   = p;
+    if (toupper(value[0]) == 'Z') e.value = -1;
+    else if (toupper(pin[0]) == 'D') e.value = atoi(value) ? 1023 : 0;
+    else e.value = constrain(atoi(value), 0, 1023);
+    trace.push_back(e);
+  }
+  fclose(f);
+  std::stable_sort(trace.begin(), trace.end(),
+                   [](const sim_trace_event &a, const sim_trace_event &b) { return a.time < b.time; });
+  return true;
+}
+
+static void capture_save()
+{
+  std::stable_sort(capture.begin(), capture.end(),
+                   [](const sim_record &a, const sim_record &b) { return a.time < b.time; });
+  for (const sim_record &r : capture) {
+    if (r.port != 0xFF)
+      fprintf(captureFile, "%12.2f %-3s %02X\n", SIM_US(r.time), simPortNames[r.port], r.value);
+    else if (r.pin >= PIN_A0)
+      fprintf(captureFile, "%12.2f IN  A%d %d\n", SIM_US(r.time), r.pin - PIN_A0, r.value);
+    else
+      fprintf(captureFile, "%12.2f IN  D%d %d\n", SIM_US(r.time), r.pin, r.value >= 512);
+  }
+  fflush(captureFile);
+}
+
+static void eeprom_load()
+{
+  FILE *f = eepromFile ? fopen(eepromFile, "rb") : NULL;
+
+  if (f == NULL) return;
+  if (fread(EEPROM.data, 1, sizeof(EEPROM.data), f) != sizeof(EEPROM.data))
+    fprintf(stderr, "%s: short EEPROM image\n", eepromFile);
+  fclose(f);
+}
+
+static void eeprom_save()
+{
+  FILE *f = eepromFile ? fopen(eepromFile, "wb") : NULL;
+
+  if (f == NULL) return;
+  fwrite(EEPROM.data, 1, sizeof(EEPROM.data), f);
+  fclose(f);
+}
+
+//
+//  Filter bench
+//
+
+void sim_filter_probe(uint8_t pedal, uint16_t input, uint16_t output)
+{
+  if (benchPin == PIN_A0 + pedal) bench.push_back({now, input, output});
+}
+
+static void bench_report()
+{
+  std::vector<sim_trace_event> ref;
+  double   lag     = 0;
+  double   error   = -1;
+  int      outMin  = 0, outMax = 0, inMin = 0, inMax = 0;
+  int      outJitter = 0, inJitter = 0;
+  unsigned long changes = 0;
+  double   rest    = 0;
+
+  for (const sim_trace_event &e : trace)
+    if (e.pin == benchPin) ref.push_back(e);
+  if (bench.empty() || ref.empty()) {
+    fprintf(stderr, "filter bench     no samples of A%d\n", benchPin - PIN_A0);
+    return;
+  }
+
+  // Oversampled reference at a time, the input before the first change of the trace
+  auto reference = [&](int64_t time) -> int {
+    auto e = std::upper_bound(ref.begin(), ref.end(), time,
+                              [](int64_t t, const sim_trace_event &e) { return t < (int64_t)e.time; });
+    return e == ref.begin() ? -1 : (e - 1)->value << SIM_ADC_HIRES_BITS;
+  };
+
+  for (double d = 0; d <= SIM_BENCH_LAG_MAX; d += SIM_BENCH_LAG_STEP) {
+    int64_t  delay = (int64_t)(d * (SIM_CPU_HZ / 1000));
+    double   sum   = 0;
+    unsigned long n = 0;
+
+    for (const sim_bench_sample &s : bench) {
+      int r = reference((int64_t)s.time - delay);
+      if (r < 0) continue;
+      sum += (double)(s.output - r) * (s.output - r);
+      n++;
+    }
+    if (n && (error < 0 || sum / n < error)) {
+      error = sum / n;
+      lag   = d;
+    }
+  }
+
+  // Jitter while the reference is at rest, worst peak-to-peak of each rest period
+  uint64_t settle = SIM_BENCH_SETTLE * (SIM_CPU_HZ / 1000);
+  uint64_t since  = SIM_NEVER;
+  for (size_t i = 0; i < bench.size(); i++) {
+    const sim_bench_sample &s = bench[i];
+    auto     e     = std::upper_bound(ref.begin(), ref.end(), s.time,
+                                      [](uint64_t t, const sim_trace_event &e) { return t < e.time; });
+    uint64_t start = (e == ref.begin()) ? SIM_NEVER : (e - 1)->time;
+
+    if (start == SIM_NEVER || s.time - start < settle) {
+      since = SIM_NEVER;
+      continue;
+    }
+    if (since != start) {
+      since  = start;
+      outMin = outMax = s.output;
+      inMin  = inMax  = s.input;
+    }
+    else {
+      if (s.output != bench[i - 1].output) changes++;
+      rest  += SIM_US(s.time - bench[i - 1].time) / 1000000;
+    }
+    outMin    = std::min(outMin, (int)s.output);
+    outMax    = std::max(outMax, (int)s.output);
+    inMin     = std::min(inMin, (int)s.input);
+    inMax     = std::max(inMax, (int)s.input);
+    outJitter = std::max(outJitter, outMax - outMin);
+    inJitter  = std::max(inJitter, inMax - inMin);
+  }
+
+  fprintf(stderr, "filter bench A%-3d %lu samples, avg %.2f ms apart\n", benchPin - PIN_A0,
+          (unsigned long)bench.size(), SIM_US(bench.back().time - bench.front().time) / 1000 / bench.size());
+  fprintf(stderr, "  lag            %.2f ms, error %.2f LSB rms\n", lag, sqrt(error));
+  fprintf(stderr, "  jitter         output %d LSB p-p, input %d LSB p-p, %lu output changes in %.2f s at rest\n",
+          outJitter, inJitter, changes, rest);
+}
+
+//
+//  Code path benchmark
+//
+
+static void code_bench_idle()
+{
+}
+
+//
+//  Run a path from the start of the benchmark, the cost per call less the one of an empty call
+//
+static void code_bench_time(void (*f)(), double &cycles, double &ns)
+{
+  traceShift = now - codeBenchStart;
+  traceNext  = codeBenchTrace;
+  memcpy(pins, codeBenchPins, sizeof(pins));
+  for (byte p = 0; p < SIM_PINS; p++) pin_update(p);
+
+  uint64_t start = now;
+  double   total = 0;
+
+  for (unsigned long i = 0; i < SIM_BENCH_ROUNDS; i++) {
+    auto host = std::chrono::steady_clock::now();
+    f();
+    total += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - host).count();
+    sim_advance(SIM_BENCH_STEP);
+  }
+  ns     = total / SIM_BENCH_ROUNDS;
+  cycles = (double)(now - start) / SIM_BENCH_ROUNDS - SIM_BENCH_STEP;
+}
+
+static void code_bench_run()
+{
+  double idleCycles, idleNs, beforeCycles, beforeNs, afterCycles, afterNs;
+
+  simInterrupts  = false;
+  codeBench->setup();
+  codeBenchStart = now;
+  codeBenchTrace = traceNext;
+  memcpy(codeBenchPins, pins, sizeof(pins));
+
+  code_bench_time(code_bench_idle, idleCycles, idleNs);
+  code_bench_time(codeBench->before, beforeCycles, beforeNs);
+  code_bench_time(codeBench->after, afterCycles, afterNs);
+  beforeNs = std::max(beforeNs - idleNs, 0.0);
+  afterNs  = std::max(afterNs - idleNs, 0.0);
+
+  fprintf(stderr, "%-16s %lu calls, 1 ms apart\n", codeBench->name, (unsigned long)SIM_BENCH_ROUNDS);
+  fprintf(stderr, "  before         virtual %8.2f us, host %8.1f ns per call\n", SIM_US(beforeCycles), beforeNs);
+  fprintf(stderr, "  after          virtual %8.2f us, host %8.1f ns per call\n", SIM_US(afterCycles), afterNs);
+  if (afterNs > 0) fprintf(stderr, "  host speedup   %.1fx\n", beforeNs / afterNs);
+  simInterrupts = true;
+}
+
+//
+//  Statistics
+//
+
+static unsigned long loops      = 0;
+static uint64_t      loopMin    = SIM_NEVER;
+static uint64_t      loopMax    = 0;
+static uint64_t      loopTotal  = 0;
+static double        loopHostNs = 0;
+
+static void sim_finish()
+{
+  capture_save();
+  eeprom_save();
+
+  fprintf(stderr, "virtual time     %.3f ms\n", SIM_US(now) / 1000);
+  if (loops) {
+    fprintf(stderr, "loop()           %lu calls\n", loops);
+    fprintf(stderr, "  virtual        min %.2f us, avg %.2f us, max %.2f us\n",
+            SIM_US(loopMin), SIM_US(loopTotal) / loops, SIM_US(loopMax));
+    fprintf(stderr, "  host           avg %.0f ns\n", loopHostNs / loops);
+  }
+  fprintf(stderr, "interrupts       timer1 %lu, timer3 %lu, adc %lu, pcint %lu\n",
+          timers[0].count, timers[1].count, adcCount, pcintCount);
+  for (byte i = 0; i < SIM_SERIAL_PORTS; i++)
+    if (serials[i].bytes) fprintf(stderr, "%-16s %lu bytes at %lu baud\n", simPortNames[i], serials[i].bytes, serials[i].baud);
+  if (eepromWrites) fprintf(stderr, "EEPROM           %lu bytes written\n", eepromWrites);
+  if (benchPin >= 0) bench_report();
+}
+
+void sim_reset()
+{
+  fprintf(stderr, "watchdog reset at %.3f ms\n", SIM_US(now) / 1000);
+  sim_finish();
+  exit(0);
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-t trace] [-o capture] [-d duration ms] [-e eeprom image]\n"
+                  "          [-f analog pin] [-n adc noise] [-b benchmark]\n", name);
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  uint64_t end = SIM_NEVER;
+
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc || argv[i][0] != '-' || argv[i][2] != 0) usage(argv[0]);
+    switch (argv[i][1]) {
+      case 't':
+        if (!trace_load(argv[++i])) { perror(argv[i]); return 1; }
+        break;
+      case 'o':
+        if ((captureFile = fopen(argv[++i], "w")) == NULL) { perror(argv[i]); return 1; }
+        break;
+      case 'd':
+        end = (uint64_t)(atof(argv[++i]) * (SIM_CPU_HZ / 1000));
+        break;
+      case 'e':
+        eepromFile = argv[++i];
+        break;
+      case 'f':
+        i++;
+        if (toupper(argv[i][0]) != 'A' || !isdigit(argv[i][1])) usage(argv[0]);
+        benchPin = PIN_A0 + atoi(argv[i] + 1);
+        break;
+      case 'n':
+        adcNoise = atoi(argv[++i]);
+        break;
+      case 'b':
+        i++;
+        for (codeBench = simBenches; codeBench->name && strcmp(codeBench->name, argv[i]); codeBench++);
+        if (codeBench->name == NULL) usage(argv[0]);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  if (end == SIM_NEVER) end = (trace.empty() ? 0 : trace.back().time) + SIM_CPU_HZ;
+
+  char top;
+  __brkval = &top - 8192;                     // 8 KB SRAM all free at the top of the stack
+
+  for (byte i = 0; i < SIM_PINS; i++) pins[i].input = -1;
+  eeprom_load();
+
+  // AVR core init(): ADC enabled at 125 kHz, interrupts on
+  ADCSRA.set((1 << ADEN) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0));
+  simInterrupts = true;
+
+  setup();
+  if (codeBench) {
+    code_bench_run();
+    end = now;
+  }
+  while (now < end) {
+    uint64_t start = now;
+    auto     host  = std::chrono::steady_clock::now();
+
+    loop();
+    sim_advance(SIM_CYCLES_LOOP);
+
+    loopHostNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - host).count();
+    loopMin     = std::min(loopMin, now - start);
+    loopMax     = std::max(loopMax, now - start);
+    loopTotal  += now - start;
+    loops++;
+  }
+  sim_finish();
+  return 0;
+}
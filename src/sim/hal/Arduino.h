@@ -0,0 +1,267 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Mock Arduino core for the host simulator (Arduino MEGA 2560 pinout)
+//
+//  Only the part of the core used by the firmware and by its libraries is provided. Every
+//  call that touches the hardware is forwarded to the simulator and charged in virtual time.
+//
+
+#ifndef _SIM_ARDUINO_H
+#define _SIM_ARDUINO_H
+
+// Standard headers first, the core macros below would break them
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+
+#include "Simulator.h"
+#include "avr/pgmspace.h"
+#include "avr/io.h"
+#include "avr/interrupt.h"
+#include "binary.h"
+
+#ifndef F_CPU
+#define F_CPU           16000000L
+#endif
+
+#define HIGH            0x1
+#define LOW             0x0
+
+#define INPUT           0x0
+#define OUTPUT          0x1
+#define INPUT_PULLUP    0x2
+
+#define DEC             10
+#define HEX             16
+#define OCT             8
+#define BIN             2
+
+#define PI              3.1415926535897932384626433832795
+#define LED_BUILTIN     13
+#define NUM_DIGITAL_PINS  SIM_PINS
+#define NOT_A_PIN       0
+#define NOT_A_PORT      0
+
+#define PIN_A0          54
+#define PIN_A1          55
+#define PIN_A2          56
+#define PIN_A3          57
+#define PIN_A4          58
+#define PIN_A5          59
+#define PIN_A6          60
+#define PIN_A7          61
+#define PIN_A8          62
+#define PIN_A9          63
+#define PIN_A10         64
+#define PIN_A11         65
+#define PIN_A12         66
+#define PIN_A13         67
+#define PIN_A14         68
+#define PIN_A15         69
+
+static const uint8_t A0 = PIN_A0, A1 = PIN_A1, A2  = PIN_A2,  A3  = PIN_A3,  A4  = PIN_A4,  A5  = PIN_A5,  A6  = PIN_A6,  A7  = PIN_A7;
+static const uint8_t A8 = PIN_A8, A9 = PIN_A9, A10 = PIN_A10, A11 = PIN_A11, A12 = PIN_A12, A13 = PIN_A13, A14 = PIN_A14, A15 = PIN_A15;
+
+typedef uint8_t   byte;
+typedef bool      boolean;
+typedef uint16_t  word;
+
+template <class T, class L> auto min(const T &a, const L &b) -> decltype((b < a) ? b : a) { return (b < a) ? b : a; }
+template <class T, class L> auto max(const T &a, const L &b) -> decltype((b < a) ? b : a) { return (a < b) ? b : a; }
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define sq(x)                     ((x) * (x))
+#define lowByte(w)                ((uint8_t)((w) & 0xff))
+#define highByte(w)               ((uint8_t)((w) >> 8))
+#define bit(b)                    (1UL << (b))
+#define bitRead(value, b)         (((value) >> (b)) & 0x01)
+#define bitSet(value, b)          ((value) |= (1UL << (b)))
+#define bitClear(value, b)        ((value) &= ~(1UL << (b)))
+#define bitWrite(value, b, v)     ((v) ? bitSet(value, b) : bitClear(value, b))
+#ifndef _BV
+#define _BV(b)                    (1 << (b))
+#endif
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+inline long random(long howbig)             { return howbig == 0 ? 0 : rand() % howbig; }
+inline long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall); }
+inline void randomSeed(unsigned long seed)  { if (seed != 0) srand(seed); }
+
+//
+//  Time
+//
+
+inline unsigned long millis()               { sim_advance(SIM_CYCLES_MILLIS); return sim_cycles() / (SIM_CPU_HZ / 1000); }
+inline unsigned long micros()               { sim_advance(SIM_CYCLES_MICROS); return sim_cycles() / (SIM_CPU_HZ / 1000000); }
+inline void delay(unsigned long ms)         { while (ms--) sim_advance(SIM_CPU_HZ / 1000); }
+inline void delayMicroseconds(unsigned int us) { sim_advance(us * (SIM_CPU_HZ / 1000000)); }
+
+inline void noInterrupts()                  { cli(); }
+inline void interrupts()                    { sei(); }
+
+//
+//  Pins (ports are synthetic: 8 consecutive pins each, pin change groups are the real ones)
+//
+
+inline void pinMode(uint8_t pin, uint8_t mode)      { sim_advance(SIM_CYCLES_PINMODE); sim_pin_mode(pin, mode); }
+inline void digitalWrite(uint8_t pin, uint8_t val)  { sim_advance(SIM_CYCLES_DIGITAL); sim_pin_write(pin, val); }
+inline int  digitalRead(uint8_t pin)                { sim_advance(SIM_CYCLES_DIGITAL); return sim_pin_read(pin); }
+inline void analogWrite(uint8_t pin, int val)       { pinMode(pin, OUTPUT); digitalWrite(pin, val < 128 ? LOW : HIGH); }
+
+// Same sequence of the AVR core, it competes for the ADC exactly like on the board
+inline int analogRead(uint8_t pin)
+{
+  if (pin >= PIN_A0) pin -= PIN_A0;
+  ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((pin >> 3) & 0x01) << MUX5);
+  ADMUX  = (1 << REFS0) | (pin & 0x07);
+  ADCSRA |= (1 << ADSC);
+  while (ADCSRA & (1 << ADSC));
+  return ADC;
+}
+
+#define digitalPinToPort(p)       ((uint8_t)((p) / 8 + 1))
+#define digitalPinToBitMask(p)    ((uint8_t)(1 << ((p) % 8)))
+#define portInputRegister(port)   ((volatile uint8_t *)&simPins[(port) - 1])
+
+#define digitalPinToPCICR(p)      ((((p) >= 10) && ((p) <= 13)) || (((p) >= 50) && ((p) <= 53)) || (((p) >= 62) && ((p) <= 69)) ? (&PCICR) : ((volatile uint8_t *)0))
+#define digitalPinToPCICRbit(p)   ((((p) >= 10) && ((p) <= 13)) || (((p) >= 50) && ((p) <= 53)) ? 0 : ((((p) >= 62) && ((p) <= 69)) ? 2 : 0))
+#define digitalPinToPCMSK(p)      ((((p) >= 10) && ((p) <= 13)) || (((p) >= 50) && ((p) <= 53)) ? (&PCMSK0) : ((((p) >= 62) && ((p) <= 69)) ? (&PCMSK2) : ((volatile uint8_t *)0)))
+#define digitalPinToPCMSKbit(p)   ((((p) >= 10) && ((p) <= 13)) ? ((p) - 6) : (((p) >= 50) && ((p) <= 53)) ? (53 - (p)) : ((((p) >= 62) && ((p) <= 69)) ? ((p) - 62) : 0))
+
+//
+//  Strings
+//
+
+class __FlashStringHelper;
+#define F(s)    (reinterpret_cast<const __FlashStringHelper *>(s))
+
+class String {
+  public:
+    String(const char *s = "")              : str(s ? s : "") {}
+    String(const __FlashStringHelper *s)    : str((const char *)s) {}
+    String(char c)                          : str(1, c) {}
+    String(int n, unsigned char base = DEC) { format(n, base); }
+    String(unsigned int n, unsigned char base = DEC)  { format(n, base); }
+    String(long n, unsigned char base = DEC)          { format(n, base); }
+    String(unsigned long n, unsigned char base = DEC) { format(n, base); }
+    String(double n, unsigned char digits = 2)        { char b[32]; snprintf(b, sizeof(b), "%.*f", digits, n); str = b; }
+
+    const char   *c_str() const             { return str.c_str(); }
+    unsigned int  length() const            { return str.length(); }
+    unsigned char reserve(unsigned int size) { str.reserve(size); return 1; }
+    unsigned char concat(const String &s)   { str += s.str; return 1; }
+    unsigned char concat(const char *s)     { if (s) str += s; return 1; }
+    unsigned char concat(char c)            { str += c; return 1; }
+    String &operator+=(const String &s)     { concat(s); return *this; }
+    String &operator+=(const char *s)       { concat(s); return *this; }
+    String &operator+=(char c)              { concat(c); return *this; }
+    bool operator==(const String &s) const  { return str == s.str; }
+    bool operator==(const char *s) const    { return str == (s ? s : ""); }
+    bool operator!=(const String &s) const  { return str != s.str; }
+    char operator[](unsigned int i) const   { return i < str.length() ? str[i] : 0; }
+    int  toInt() const                      { return atol(str.c_str()); }
+
+  private:
+    std::string str;
+
+    void format(long n, unsigned char base)
+    {
+      if (base == DEC) { char b[16]; snprintf(b, sizeof(b), "%ld", n); str = b; }
+      else format((unsigned long)n, base);
+    }
+    void format(unsigned long n, unsigned char base)
+    {
+      char  b[8 * sizeof(long) + 1];
+      char *p = &b[sizeof(b) - 1];
+      *p = 0;
+      do { byte d = n % base; *--p = d < 10 ? '0' + d : 'A' + d - 10; n /= base; } while (n);
+      str = p;
+    }
+    void format(int n, unsigned char base)          { format((long)n, base); }
+    void format(unsigned int n, unsigned char base) { format((unsigned long)n, base); }
+};
+
+//
+//  Print, Stream and the four hardware serial ports
+//
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+      size_t n = 0;
+      while (size--) n += write(*buffer++);
+      return n;
+    }
+    size_t write(const char *s)                         { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+    size_t write(const char *buffer, size_t size)       { return write((const uint8_t *)buffer, size); }
+
+    size_t print(const char *s)                         { return write(s); }
+    size_t print(const __FlashStringHelper *s)          { return write((const char *)s); }
+    size_t print(const String &s)                       { return write(s.c_str()); }
+    size_t print(char c)                                { return write((uint8_t)c); }
+    size_t print(unsigned char n, int base = DEC)       { return print(String(n, base)); }
+    size_t print(int n, int base = DEC)                 { return print(String(n, base)); }
+    size_t print(unsigned int n, int base = DEC)        { return print(String(n, base)); }
+    size_t print(long n, int base = DEC)                { return print(String(n, base)); }
+    size_t print(unsigned long n, int base = DEC)       { return print(String(n, base)); }
+    size_t print(double n, int digits = 2)              { return print(String(n, digits)); }
+
+    size_t println()                                    { return write("\r\n"); }
+    template <typename T> size_t println(T v)           { size_t n = print(v); return n + println(); }
+    template <typename T> size_t println(T v, int f)    { size_t n = print(v, f); return n + println(); }
+};
+
+class Stream : public Print {
+  public:
+    virtual int  available() = 0;
+    virtual int  read() = 0;
+    virtual int  peek() = 0;
+    virtual void flush() {}
+};
+
+class HardwareSerial : public Stream {
+  public:
+    HardwareSerial(uint8_t p) : port(p) {}
+    void   begin(unsigned long baud, uint8_t config = 0)  { sim_serial_begin(port, baud); }
+    void   end()                                          { sim_serial_flush(port); sim_serial_begin(port, 0); }
+    int    available()                                    { sim_advance(SIM_CYCLES_REGISTER); return 0; }
+    int    read()                                         { sim_advance(SIM_CYCLES_REGISTER); return -1; }
+    int    peek()                                         { return -1; }
+    int    availableForWrite()                            { return sim_serial_room(port); }
+    void   flush()                                        { sim_serial_flush(port); }
+    size_t write(uint8_t b)                               { sim_serial_write(port, b); return 1; }
+    using  Print::write;
+    operator bool()                                       { return true; }
+  private:
+    uint8_t port;
+};
+
+extern HardwareSerial Serial;                 // USB
+extern HardwareSerial Serial1;                // Bluetooth
+extern HardwareSerial Serial2;                // DIN MIDI
+extern HardwareSerial Serial3;                // ESP8266/ESP32
+
+void setup();
+void loop();
+
+#endif  // _SIM_ARDUINO_H
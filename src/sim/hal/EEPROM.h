@@ -0,0 +1,52 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  4 KB EEPROM of the ATmega2560 in host memory, loaded and saved by the simulator
+//
+
+#ifndef _SIM_EEPROM_H
+#define _SIM_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Simulator.h"
+
+#define SIM_EEPROM_SIZE   4096
+#define E2END             (SIM_EEPROM_SIZE - 1)     // last EEPROM address (avr/io.h)
+
+class EEPROMClass {
+  public:
+    uint8_t data[SIM_EEPROM_SIZE];
+
+    EEPROMClass()                   { memset(data, 0xFF, sizeof(data)); }
+    uint16_t length()               { return SIM_EEPROM_SIZE; }
+    uint8_t  read(int idx)          { sim_advance(SIM_CYCLES_EEPROM); return data[idx]; }
+    void     write(int idx, uint8_t val)  { sim_advance(SIM_CYCLES_EEPROM_WRITE); data[idx] = val; sim_eeprom_written(); }
+    void     update(int idx, uint8_t val) { if (read(idx) != val) write(idx, val); }
+
+    template <typename T> T &get(int idx, T &t)
+    {
+      uint8_t *p = (uint8_t *)&t;
+      for (unsigned int i = 0; i < sizeof(T); i++) p[i] = read(idx + i);
+      return t;
+    }
+
+    template <typename T> const T &put(int idx, const T &t)
+    {
+      const uint8_t *p = (const uint8_t *)&t;
+      for (unsigned int i = 0; i < sizeof(T); i++) update(idx + i, p[i]);
+      return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif  // _SIM_EEPROM_H
@@ -0,0 +1,73 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Host simulator interface
+//
+//  The mock Arduino HAL in this directory forwards every access to the hardware to these
+//  functions. The simulator keeps a virtual clock in CPU cycles: each HAL call charges an
+//  estimated cost, time moves only when the firmware touches the hardware, and timer, ADC
+//  and pin change interrupts are dispatched at their virtual time when interrupts are enabled.
+//
+
+#ifndef _SIMULATOR_H
+#define _SIMULATOR_H
+
+#include <stdint.h>
+
+#define SIM_CPU_HZ            16000000UL
+#define SIM_PINS              70              // Arduino MEGA digital pins, A0-A15 are 54-69
+#define SIM_PORTS             ((SIM_PINS + 7) / 8)
+
+// Estimated cost in CPU cycles of the HAL calls (AVR core at 16 MHz)
+#define SIM_CYCLES_REGISTER   2
+#define SIM_CYCLES_MILLIS     40
+#define SIM_CYCLES_MICROS     60
+#define SIM_CYCLES_PINMODE    80
+#define SIM_CYCLES_DIGITAL    60
+#define SIM_CYCLES_SERIAL     80              // per byte queued into the TX buffer
+#define SIM_CYCLES_EEPROM     30              // per byte read, writes cost SIM_CYCLES_EEPROM_WRITE
+#define SIM_CYCLES_EEPROM_WRITE 54400         // 3.4 ms per byte
+#define SIM_CYCLES_ISR        40              // interrupt entry and exit
+#define SIM_CYCLES_LOOP       200             // loop() call and main() overhead
+
+extern volatile bool simInterrupts;           // global interrupt enable (SREG I bit)
+extern uint8_t       simPins[SIM_PORTS];      // PINx registers, 8 pins each
+
+uint64_t sim_cycles();
+void     sim_advance(uint32_t cycles);        // move the virtual clock and run the hardware
+void     sim_poll();                          // dispatch pending interrupts if enabled
+void     sim_register_written(const volatile void *reg);
+
+void     sim_pin_mode(uint8_t pin, uint8_t mode);
+void     sim_pin_write(uint8_t pin, uint8_t value);
+int      sim_pin_read(uint8_t pin);
+
+void     sim_serial_begin(uint8_t port, unsigned long baud);
+void     sim_serial_write(uint8_t port, uint8_t b);
+int      sim_serial_room(uint8_t port);
+void     sim_serial_flush(uint8_t port);
+
+void     sim_eeprom_written();
+void     sim_reset();                         // watchdog reset: end of simulation
+
+void     sim_filter_probe(uint8_t pedal, uint16_t input, uint16_t output);  // analog filter bench
+
+// Code path benchmarks (-b name), built with the firmware from ../Bench.h
+struct sim_bench {
+  const char  *name;
+  void       (*setup)();                    // after setup(), before the two paths
+  void       (*before)();                   // the code path replaced, kept as the reference
+  void       (*after)();                    // the firmware code path
+};
+
+extern const sim_bench simBenches[];        // ends with a null name
+
+#endif  // _SIMULATOR_H
@@ -0,0 +1,32 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Interrupt vectors are plain functions called by the simulator when the interrupt is due
+//
+
+#ifndef _SIM_AVR_INTERRUPT_H
+#define _SIM_AVR_INTERRUPT_H
+
+#include "Simulator.h"
+
+#define TIMER1_COMPA_vect   sim_timer1_compa_vect
+#define TIMER3_COMPA_vect   sim_timer3_compa_vect
+#define ADC_vect            sim_adc_vect
+#define PCINT0_vect         sim_pcint0_vect
+#define PCINT1_vect         sim_pcint1_vect
+#define PCINT2_vect         sim_pcint2_vect
+
+#define ISR(vector, ...)    extern "C" void vector(void)
+
+inline void cli() { simInterrupts = false; }
+inline void sei() { simInterrupts = true; sim_poll(); }
+
+#endif  // _SIM_AVR_INTERRUPT_H
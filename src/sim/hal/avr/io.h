@@ -0,0 +1,87 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  ATmega2560 registers used by the firmware
+//
+//  Control registers are objects: a read charges SIM_CYCLES_REGISTER (so a busy wait on a flag
+//  lets the hardware progress) and a write notifies the simulator (to start a conversion or
+//  reprogram a timer). PINx and the pin change registers stay plain bytes because the firmware
+//  keeps pointers to them.
+//
+
+#ifndef _SIM_AVR_IO_H
+#define _SIM_AVR_IO_H
+
+#include <stdint.h>
+#include "Simulator.h"
+
+template <typename T>
+class sim_register {
+  public:
+    sim_register(T v = 0) : value(v) {}
+    operator T() const                  { sim_advance(SIM_CYCLES_REGISTER); return value; }
+    sim_register &operator=(T v)        { value = v; sim_register_written(this); return *this; }
+    sim_register &operator|=(T v)       { return *this = T(*this) | v; }
+    sim_register &operator&=(T v)       { return *this = T(*this) & v; }
+    sim_register &operator^=(T v)       { return *this = T(*this) ^ v; }
+    T    raw() const                    { return value; }     // simulator only, no cost
+    void set(T v)                       { value = v; }        // simulator only, no notification
+  private:
+    volatile T value;
+};
+
+typedef sim_register<uint8_t>   sim_reg8;
+typedef sim_register<uint16_t>  sim_reg16;
+
+// Timer/Counter1 (MidiTimeCode)
+extern sim_reg8   TCCR1A, TCCR1B, TIMSK1;
+extern sim_reg16  TCNT1, OCR1A;
+#define WGM12     3
+#define CS12      2
+#define CS11      1
+#define CS10      0
+#define OCIE1A    1
+
+// Timer/Counter3 (switch scanner)
+extern sim_reg8   TCCR3A, TCCR3B, TIMSK3;
+extern sim_reg16  TCNT3, OCR3A;
+#define WGM32     3
+#define CS32      2
+#define CS31      1
+#define CS30      0
+#define OCIE3A    1
+
+// ADC
+extern sim_reg8   ADCSRA, ADCSRB, ADMUX;
+extern sim_reg16  ADC;
+#define ADEN      7
+#define ADSC      6
+#define ADATE     5
+#define ADIF      4
+#define ADIE      3
+#define ADPS2     2
+#define ADPS1     1
+#define ADPS0     0
+#define MUX5      3
+#define REFS1     7
+#define REFS0     6
+#define ADLAR     5
+
+// Pin change interrupts
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+#define PCIE0     0
+#define PCIE1     1
+#define PCIE2     2
+#define PCIF0     0
+#define PCIF1     1
+#define PCIF2     2
+
+#endif  // _SIM_AVR_IO_H
@@ -0,0 +1,41 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  Program memory is ordinary memory on the host
+//
+
+#ifndef _SIM_AVR_PGMSPACE_H
+#define _SIM_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PGM_P                     const char *
+#define PSTR(s)                   (s)
+
+#define pgm_read_byte(p)          (*(const uint8_t *)(p))
+#define pgm_read_byte_near(p)     pgm_read_byte(p)
+#define pgm_read_word(p)          (*(const uint16_t *)(p))
+#define pgm_read_word_near(p)     pgm_read_word(p)
+#define pgm_read_dword(p)         (*(const uint32_t *)(p))
+#define pgm_read_ptr(p)           (*(void * const *)(p))
+
+#define memcpy_P                  memcpy
+#define strcpy_P                  strcpy
+#define strncpy_P                 strncpy
+#define strcmp_P                  strcmp
+#define strlen_P                  strlen
+#define sprintf_P                 sprintf
+#define snprintf_P                snprintf
+
+#endif  // _SIM_AVR_PGMSPACE_H
@@ -0,0 +1,28 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  A watchdog reset ends the simulation
+//
+
+#ifndef _SIM_AVR_WDT_H
+#define _SIM_AVR_WDT_H
+
+#include "Simulator.h"
+
+#define WDTO_15MS   0
+#define WDTO_30MS   1
+#define WDTO_1S     6
+
+inline void wdt_enable(uint8_t) { sim_reset(); }
+inline void wdt_disable()       {}
+inline void wdt_reset()         {}
+
+#endif  // _SIM_AVR_WDT_H
@@ -0,0 +1,34 @@
+/*  __________           .___      .__  .__                   ___ ________________    ___
+ *  \______   \ ____   __| _/____  |  | |__| ____   ____     /  / \__    ___/     \   \  \   
+ *   |     ___// __ \ / __ |\__  \ |  | |  |/    \ /  _ \   /  /    |    | /  \ /  \   \  \  
+ *   |    |   \  ___// /_/ | / __ \|  |_|  |   |  (  <_> ) (  (     |    |/    Y    \   )  )
+ *   |____|    \___  >____ |(____  /____/__|___|  /\____/   \  \    |____|\____|__  /  /  /
+ *                 \/     \/     \/             \/           \__\                 \/  /__/
+ *                                                                (c) 2018 alf45star
+ *                                                        https://github.com/alf45tar/Pedalino
+ */
+
+//
+//  ATOMIC_BLOCK() on the simulated interrupt enable flag
+//
+
+#ifndef _SIM_UTIL_ATOMIC_H
+#define _SIM_UTIL_ATOMIC_H
+
+#include "Simulator.h"
+
+class sim_atomic {
+  public:
+    sim_atomic() : saved(simInterrupts), done(false) { simInterrupts = false; }
+    ~sim_atomic()   { simInterrupts = saved; if (saved) sim_poll(); }
+    bool once()     { if (done) return false; return done = true; }
+  private:
+    bool saved;
+    bool done;
+};
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+#define ATOMIC_BLOCK(type)  for (sim_atomic sim_atomic_guard; sim_atomic_guard.once(); )
+
+#endif  // _SIM_UTIL_ATOMIC_H